@@ -0,0 +1,269 @@
+#ifndef STATEFUL_POINTER_CHARCONV_HPP
+#define STATEFUL_POINTER_CHARCONV_HPP
+
+/// Conversion between numbers and basic_string. Numbers are formatted into a
+/// buffer on the stack and copied once into the string, so that short numbers
+/// do not allocate at all and long ones allocate exactly once. Floating point
+/// numbers always use '.' as the decimal point, whatever the current locale.
+
+#include "boost/type_traits.hpp"
+#include "boost/utility/enable_if.hpp"
+#include "stateful_pointer/string.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <system_error>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#define STATEFUL_POINTER_HAS_USELOCALE 1
+#else
+#include <clocale>
+#endif
+
+namespace stateful_pointer {
+
+namespace detail {
+inline const char *digit_pairs() noexcept {
+  return "00010203040506070809"
+         "10111213141516171819"
+         "20212223242526272829"
+         "30313233343536373839"
+         "40414243444546474849"
+         "50515253545556575859"
+         "60616263646566676869"
+         "70717273747576777879"
+         "80818283848586878889"
+         "90919293949596979899";
+}
+
+template <typename UInt> unsigned count_digits(UInt v) noexcept {
+  unsigned n = 1;
+  for (;;) {
+    if (v < 10)
+      return n;
+    if (v < 100)
+      return n + 1;
+    if (v < 1000)
+      return n + 2;
+    if (v < 10000)
+      return n + 3;
+    v /= 10000;
+    n += 4;
+  }
+}
+
+/// write decimal digits of v backwards, ending just before end
+template <typename UInt, typename It> void write_digits(UInt v, It end) {
+  const auto t = digit_pairs();
+  while (v >= 100) {
+    const auto i = static_cast<unsigned>(v % 100) * 2;
+    v /= 100;
+    *--end = t[i + 1];
+    *--end = t[i];
+  }
+  if (v >= 10) {
+    const auto i = static_cast<unsigned>(v) * 2;
+    *--end = t[i + 1];
+    *--end = t[i];
+  } else {
+    *--end = static_cast<char>('0' + v);
+  }
+}
+
+template <typename TChar, typename Int>
+basic_string<TChar> integer_to_string(Int v) {
+  using uint_t = typename ::boost::make_unsigned<Int>::type;
+  const bool neg = v < 0;
+  const uint_t u = neg ? uint_t(0) - static_cast<uint_t>(v) : uint_t(v);
+  TChar buf[std::numeric_limits<uint_t>::digits10 + 2];
+  const auto end = buf + sizeof(buf) / sizeof(TChar);
+  const auto n = count_digits(u);
+  write_digits(u, end);
+  auto first = end - n;
+  if (neg)
+    *--first = '-';
+  return basic_string<TChar>(first, end);
+}
+
+inline float strto(const char *s, char **end, float) {
+  return std::strtof(s, end);
+}
+inline double strto(const char *s, char **end, double) {
+  return std::strtod(s, end);
+}
+inline long double strto(const char *s, char **end, long double) {
+  return std::strtold(s, end);
+}
+
+#ifdef STATEFUL_POINTER_HAS_USELOCALE
+// switches the calling thread to the "C" locale while it lives, so that
+// snprintf and strtod use '.' as the decimal point
+class c_locale_scope {
+public:
+  c_locale_scope() : old_(::uselocale(get())) {}
+  ~c_locale_scope() { ::uselocale(old_); }
+  c_locale_scope(const c_locale_scope &) = delete;
+  c_locale_scope &operator=(const c_locale_scope &) = delete;
+
+  char decimal_point() const noexcept { return '.'; }
+
+private:
+  static ::locale_t get() {
+    static const ::locale_t loc = ::newlocale(LC_ALL_MASK, "C", ::locale_t());
+    return loc;
+  }
+
+  ::locale_t old_;
+};
+#else
+// without uselocale, the decimal point of the global locale is translated
+class c_locale_scope {
+public:
+  char decimal_point() const noexcept {
+    return *std::localeconv()->decimal_point;
+  }
+};
+#endif
+
+// shorter of the two precisions which reads back to the same value
+template <typename TChar, typename Float>
+basic_string<TChar> float_to_string(Float v, int short_precision,
+                                    int long_precision) {
+  const c_locale_scope scope;
+  char buf[32];
+  auto n = std::snprintf(buf, sizeof(buf), "%.*g", short_precision, v);
+  if (strto(buf, nullptr, Float()) != v)
+    n = std::snprintf(buf, sizeof(buf), "%.*g", long_precision, v);
+  const char point = scope.decimal_point();
+  for (auto i = 0; i < n; ++i)
+    if (buf[i] == point)
+      buf[i] = '.';
+  return basic_string<TChar>(buf, buf + n);
+}
+} // namespace detail
+
+inline string to_string(int v) { return detail::integer_to_string<char>(v); }
+inline string to_string(long v) { return detail::integer_to_string<char>(v); }
+inline string to_string(long long v) {
+  return detail::integer_to_string<char>(v);
+}
+inline string to_string(unsigned v) {
+  return detail::integer_to_string<char>(v);
+}
+inline string to_string(unsigned long v) {
+  return detail::integer_to_string<char>(v);
+}
+inline string to_string(unsigned long long v) {
+  return detail::integer_to_string<char>(v);
+}
+
+/// unlike std::to_string, uses the shorter of %.15g/%.17g (%.6g/%.9g for
+/// float) that reads back exactly, which is not always the shortest form
+inline string to_string(float v) {
+  return detail::float_to_string<char>(v, 6, 9);
+}
+inline string to_string(double v) {
+  return detail::float_to_string<char>(v, 15, 17);
+}
+
+/// result of from_chars, like std::from_chars_result of C++17
+template <typename TChar> struct from_chars_result {
+  const TChar *ptr;
+  std::errc ec;
+};
+
+/// parse an integer in [first, last) like std::from_chars of C++17
+template <typename TChar, typename Int>
+typename ::boost::enable_if_c<::boost::is_integral<Int>::value,
+                              from_chars_result<TChar>>::type
+from_chars(const TChar *first, const TChar *last, Int &value) {
+  using uint_t = typename ::boost::make_unsigned<Int>::type;
+  auto it = first;
+  const bool neg = ::boost::is_signed<Int>::value && it != last && *it == '-';
+  if (neg)
+    ++it;
+  const auto digits = it;
+  const uint_t limit =
+      neg ? uint_t(0) - static_cast<uint_t>(std::numeric_limits<Int>::min())
+          : static_cast<uint_t>(std::numeric_limits<Int>::max());
+  uint_t u = 0;
+  bool overflow = false;
+  for (; it != last && *it >= '0' && *it <= '9'; ++it) {
+    const uint_t d = *it - '0';
+    if (u > (limit - d) / 10)
+      overflow = true;
+    else
+      u = u * 10 + d;
+  }
+  if (it == digits)
+    return {first, std::errc::invalid_argument};
+  if (overflow)
+    return {it, std::errc::result_out_of_range};
+  value = neg ? static_cast<Int>(uint_t(0) - u) : static_cast<Int>(u);
+  return {it, std::errc()};
+}
+
+/// parse a float or double in [first, last) like std::from_chars of C++17
+template <typename TChar, typename Float>
+typename ::boost::enable_if_c<::boost::is_floating_point<Float>::value,
+                              from_chars_result<TChar>>::type
+from_chars(const TChar *first, const TChar *last, Float &value) {
+  // strtod needs a null-terminated narrow string and skips leading spaces
+  // and '+', which from_chars does not accept
+  if (first == last || *first == '+' ||
+      static_cast<unsigned long>(*first) <= ' ')
+    return {first, std::errc::invalid_argument};
+  const detail::c_locale_scope scope;
+  const char point = scope.decimal_point();
+  char small[64];
+  std::string large;
+  char *buf = small;
+  const std::size_t n = last - first;
+  if (n >= sizeof(small)) {
+    large.resize(n + 1);
+    buf = &large[0];
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    // non-ASCII and a decimal point other than '.' stop parsing
+    const auto c = static_cast<unsigned long>(first[i]);
+    if (c == '.')
+      buf[i] = point;
+    else if (c < 128 && c != static_cast<unsigned char>(point))
+      buf[i] = static_cast<char>(c);
+    else
+      buf[i] = '\0';
+  }
+  buf[n] = '\0';
+  // strtod reads hex floats, from_chars only reads the leading "0"
+  const std::size_t digits = buf[0] == '-';
+  if (buf[digits] == '0' && (buf[digits + 1] == 'x' || buf[digits + 1] == 'X'))
+    buf[digits + 1] = '\0';
+  char *end = nullptr;
+  errno = 0;
+  const auto v = detail::strto(buf, &end, Float());
+  if (end == buf)
+    return {first, std::errc::invalid_argument};
+  // subnormal results also set ERANGE, but are representable
+  if (errno == ERANGE && (v == 0 || std::isinf(v)))
+    return {first + (end - buf), std::errc::result_out_of_range};
+  value = v;
+  return {first + (end - buf), std::errc()};
+}
+
+/// parse a number from the whole string or a prefix of it
+template <typename TChar, typename Encoding, typename T>
+from_chars_result<TChar> from_chars(const basic_string<TChar, Encoding> &s,
+                                    T &value) {
+  return from_chars(s.begin(), s.end(), value);
+}
+
+} // namespace stateful_pointer
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef STATEFUL_POINTER_GC_ARENA_HPP
+#define STATEFUL_POINTER_GC_ARENA_HPP
+
+/// Mark-sweep collection for graphs of objects which may contain cycles.
+///
+/// Objects are created by a gc_arena and refer to each other through gc_ptr,
+/// a copyable, non-owning tagged pointer. Specialize gc_traits for the object
+/// type to tell the collector where the gc_ptr members are. Every object is
+/// preceded by a header word which links all objects of the arena in a list;
+/// the lowest tag bit of that link is the mark bit.
+
+#include "boost/assert.hpp"
+#include "boost/cstdint.hpp"
+#include "stateful_pointer/tagged_ptr.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace stateful_pointer {
+
+/// non-owning pointer to an object in a gc_arena with Nbits of extra state
+template <typename T, unsigned Nbits = 0> class gc_ptr {
+public:
+  using bits_type = ::boost::uintptr_t;
+  using element_type = T;
+  using pointer = element_type *;
+  using reference = element_type &;
+
+  constexpr gc_ptr() noexcept : value(0) {}
+
+  /// get tag bits as integral type
+  bits_type bits() const noexcept { return value & tag_mask; }
+
+  /// set tag bits via integral type, ptr bits are not overridden
+  void bits(bits_type b) noexcept {
+    value &= ptr_mask;
+    value |= (b & tag_mask);
+  }
+
+  /// get bit at position pos
+  bool bit(unsigned pos) const noexcept { return value & (1 << pos); }
+
+  /// set bit at position pos to value b
+  void bit(unsigned pos, bool b) noexcept {
+    BOOST_ASSERT(pos < Nbits);
+    if (b)
+      value |= (1 << pos);
+    else
+      value &= ~(1 << pos);
+  }
+
+  /// get raw pointer
+  pointer get() const noexcept {
+    return reinterpret_cast<pointer>(value & ptr_mask);
+  }
+
+  auto operator*() const -> reference {
+    const auto p = get();
+    BOOST_ASSERT(p != nullptr);
+    return *p;
+  }
+
+  pointer operator->() const noexcept { return get(); }
+
+  explicit operator bool() const noexcept { return static_cast<bool>(get()); }
+
+  bool operator!() const noexcept { return get() == 0; }
+
+private:
+  static constexpr bits_type ptr_mask = detail::make_ptr_mask(Nbits);
+  static constexpr bits_type tag_mask = ~ptr_mask;
+
+  explicit gc_ptr(pointer p) noexcept
+      : value(reinterpret_cast<bits_type>(p)) {}
+
+  friend bool operator==(const gc_ptr &a, const gc_ptr &b) noexcept {
+    return a.value == b.value;
+  }
+
+  friend bool operator!=(const gc_ptr &a, const gc_ptr &b) noexcept {
+    return a.value != b.value;
+  }
+
+  template <typename U, unsigned M, typename A> friend class gc_arena;
+
+  bits_type value;
+};
+
+/// specialize for T and call f on every gc_ptr member of t
+template <typename T> struct gc_traits {
+  template <typename F> static void for_each_child(T &, F &&) {}
+};
+
+/// owns all objects made by it; collect() frees those which cannot be reached
+/// from the roots. Neither make() nor collect() may run concurrently with
+/// other uses of the arena.
+template <typename T, unsigned Nbits = 0,
+          typename Allocator = default_allocator>
+class gc_arena {
+public:
+  using pointer = gc_ptr<T, Nbits>;
+
+  gc_arena() = default;
+  gc_arena(const gc_arena &) = delete;
+  gc_arena &operator=(const gc_arena &) = delete;
+
+  ~gc_arena() { sweep(); }
+
+  /// create a new object, it lives until a collection cannot reach it
+  template <typename... Args> pointer make(Args &&... args) {
+    const auto size = alignment() + sizeof(T);
+    auto address = static_cast<char *>(Allocator::allocate(alignment(), size));
+    auto p = reinterpret_cast<T *>(address + alignment());
+    try {
+      new (p) T(std::forward<Args>(args)...);
+    } catch (...) {
+      Allocator::deallocate(address);
+      throw;
+    }
+    detail::stats_allocate<T, Nbits>(alignment(), size);
+    new (address) header(head_.load(std::memory_order_relaxed));
+    head_.store(reinterpret_cast<word>(address), std::memory_order_relaxed);
+    ++size_;
+    return pointer(p);
+  }
+
+  /// mark all objects reachable from the gc_ptr in [first, last) using up to
+  /// the given number of threads, then free the others; return number freed
+  ///
+  /// If a thread cannot be started, the others do its work. If marking
+  /// throws, nothing is freed and the exception is passed on.
+  template <typename InputIt>
+  std::size_t collect(InputIt first, InputIt last, unsigned threads = 1) {
+    marker m(std::max(threads, 1u));
+    std::vector<std::thread> workers;
+    try {
+      std::vector<std::vector<header *>> stacks(m.nthreads);
+      for (std::size_t i = 0; first != last; ++first) {
+        const pointer &p = *first;
+        if (p && mark(header_of(p.get())))
+          stacks[i++ % stacks.size()].push_back(header_of(p.get()));
+      }
+      workers.reserve(stacks.size() - 1);
+      std::size_t i = 1;
+      try {
+        for (; i < stacks.size(); ++i)
+          workers.emplace_back(&marker::run, &m, std::ref(stacks[i]));
+      } catch (const std::system_error &) {
+        m.shrink(workers.size() + 1);
+        for (; i < stacks.size(); ++i)
+          stacks[0].insert(stacks[0].end(), stacks[i].begin(),
+                           stacks[i].end());
+      }
+      m.run(stacks[0]);
+    } catch (...) {
+      m.stop();
+      for (auto &w : workers)
+        w.join();
+      unmark();
+      throw;
+    }
+    for (auto &w : workers)
+      w.join();
+    return sweep();
+  }
+
+  /// number of objects alive
+  std::size_t size() const noexcept { return size_; }
+
+private:
+  using word = ::boost::uintptr_t;
+  using header = std::atomic<word>;
+
+  static constexpr word mark_bit = 1;
+  static constexpr word ptr_mask = detail::make_ptr_mask(1);
+
+  // the header is padded to the alignment of T, so that gc_ptr has Nbits free
+  static constexpr std::size_t alignment() noexcept {
+    return detail::max(detail::alloc_alignment<T, Nbits>(),
+                       detail::max(alignof(header), sizeof(header)));
+  }
+
+  static header *header_of(T *p) noexcept {
+    return reinterpret_cast<header *>(reinterpret_cast<char *>(p) -
+                                      alignment());
+  }
+
+  static T *value_of(header *h) noexcept {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(h) + alignment());
+  }
+
+  /// set mark bit, return true if it was not set before
+  static bool mark(header *h) noexcept {
+    return !(h->fetch_or(mark_bit, std::memory_order_relaxed) & mark_bit);
+  }
+
+  /// parallel marking, threads hand over work when others ran out of it
+  struct marker {
+    // most entries handed over at once
+    static constexpr std::size_t batch = 64;
+
+    explicit marker(std::size_t n) : nthreads(n) {}
+
+    // n threads run, when fewer could be started than planned
+    void shrink(std::size_t n) {
+      std::lock_guard<std::mutex> lock(mutex);
+      nthreads = n;
+      cv.notify_all();
+    }
+
+    // makes the other threads return once their own stack is empty
+    void stop() {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+      cv.notify_all();
+    }
+
+    void run(std::vector<header *> &stack) {
+      auto visit = [&stack](const pointer &c) {
+        if (c && mark(header_of(c.get())))
+          stack.push_back(header_of(c.get()));
+      };
+      for (;;) {
+        while (!stack.empty()) {
+          auto h = stack.back();
+          stack.pop_back();
+          gc_traits<T>::for_each_child(*value_of(h), visit);
+          // a depth-first walk keeps the stack short, so hand over the
+          // oldest half, which holds the largest subgraphs
+          if (stack.size() > 1 && idle.load(std::memory_order_relaxed) > 0 &&
+              available.load(std::memory_order_relaxed) == 0) {
+            const auto half = stack.size() / 2;
+            const std::size_t n = half < batch ? half : batch;
+            std::lock_guard<std::mutex> lock(mutex);
+            shared.insert(shared.end(), stack.begin(), stack.begin() + n);
+            stack.erase(stack.begin(), stack.begin() + n);
+            available.store(shared.size(), std::memory_order_relaxed);
+            cv.notify_all();
+          }
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        ++idle;
+        while (shared.empty() && idle < nthreads && !stopped)
+          cv.wait(lock);
+        if (stopped)
+          return;
+        if (shared.empty()) { // everyone is idle, marking is complete
+          cv.notify_all();
+          return;
+        }
+        --idle;
+        const std::size_t n = shared.size() < batch ? shared.size() : batch;
+        stack.assign(shared.end() - n, shared.end());
+        shared.resize(shared.size() - n);
+        available.store(shared.size(), std::memory_order_relaxed);
+      }
+    }
+
+    std::size_t nthreads; // guarded by mutex, like shared
+    bool stopped = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<header *> shared;
+    std::atomic<std::size_t> idle{0};
+    std::atomic<std::size_t> available{0}; // size of shared
+  };
+
+  void unmark() noexcept {
+    word next = head_.load(std::memory_order_relaxed);
+    while (next) {
+      auto h = reinterpret_cast<header *>(next);
+      next = h->fetch_and(~mark_bit, std::memory_order_relaxed) & ptr_mask;
+    }
+  }
+
+  /// unlink unmarked objects and clear marks, then free garbage in bulk
+  std::size_t sweep() noexcept {
+    word garbage = 0;
+    header *prev = &head_;
+    word next = head_.load(std::memory_order_relaxed);
+    while (next) {
+      auto h = reinterpret_cast<header *>(next);
+      const auto w = h->load(std::memory_order_relaxed);
+      next = w & ptr_mask;
+      if (w & mark_bit) {
+        h->store(next, std::memory_order_relaxed);
+        prev = h;
+      } else {
+        prev->store(next, std::memory_order_relaxed);
+        h->store(garbage, std::memory_order_relaxed);
+        garbage = reinterpret_cast<word>(h);
+      }
+    }
+    std::size_t n = 0;
+    while (garbage) {
+      auto h = reinterpret_cast<header *>(garbage);
+      garbage = h->load(std::memory_order_relaxed);
+      value_of(h)->~T();
+      h->~header();
+      detail::stats_deallocate<T, Nbits>(alignment(),
+                                         alignment() + sizeof(T));
+      Allocator::deallocate(h);
+      ++n;
+    }
+    size_ -= n;
+    return n;
+  }
+
+  header head_{0};
+  std::size_t size_ = 0;
+};
+
+} // namespace stateful_pointer
+
+#endif
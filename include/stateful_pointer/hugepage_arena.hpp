@@ -0,0 +1,164 @@
+#ifndef STATEFUL_POINTER_HUGEPAGE_ARENA_HPP
+#define STATEFUL_POINTER_HUGEPAGE_ARENA_HPP
+
+#include "boost/align/align_up.hpp"
+#include "boost/align/aligned_alloc.hpp"
+#include "boost/assert.hpp"
+#include "boost/cstdint.hpp"
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define STATEFUL_POINTER_HAS_MMAP 1
+#endif
+
+namespace stateful_pointer {
+
+/// bump-pointer arena which maps memory in large chunks backed by huge pages
+///
+/// Chunks are mapped with MAP_HUGETLB if the system has reserved huge pages,
+/// otherwise with normal pages and the hint MADV_HUGEPAGE for transparent huge
+/// pages. On platforms without mmap, chunks are ordinary aligned allocations.
+/// deallocate does not reuse memory, it is only returned to the system when
+/// the arena is destroyed. The arena is not thread-safe.
+class hugepage_arena {
+public:
+  /// size and alignment of a huge page on x86-64 and common ARM systems
+  static constexpr std::size_t huge_page_size() noexcept {
+    return 2 * 1024 * 1024;
+  }
+
+  explicit hugepage_arena(std::size_t chunk_size = 32 * huge_page_size())
+      : chunk_size_(
+            ::boost::alignment::align_up(chunk_size, huge_page_size())) {}
+
+  hugepage_arena(const hugepage_arena &) = delete;
+  hugepage_arena &operator=(const hugepage_arena &) = delete;
+
+  ~hugepage_arena() {
+    for (const auto &c : chunks_)
+      unmap(c.first, c.second);
+  }
+
+  /// get memory with given alignment, throws std::bad_alloc if mapping fails
+  void *allocate(std::size_t alignment, std::size_t size) {
+    BOOST_ASSERT(alignment <= huge_page_size());
+    auto p = static_cast<char *>(
+        ::boost::alignment::align_up(static_cast<void *>(cur_), alignment));
+    if (!cur_ || p + size > end_) {
+      map(::boost::alignment::align_up(size, huge_page_size()) > chunk_size_
+              ? ::boost::alignment::align_up(size, huge_page_size())
+              : chunk_size_);
+      p = cur_;
+    }
+    used_bytes_ += size;
+    cur_ = p + size;
+    return p;
+  }
+
+  /// no-op, memory is released when the arena is destroyed
+  void deallocate(void *) noexcept {}
+
+  /// bytes mapped from the system
+  std::size_t mapped_bytes() const noexcept { return mapped_bytes_; }
+
+  /// bytes of mapped memory which are backed by MAP_HUGETLB or MADV_HUGEPAGE
+  std::size_t huge_page_bytes() const noexcept { return huge_page_bytes_; }
+
+  /// bytes handed out by allocate, excluding alignment padding
+  std::size_t used_bytes() const noexcept { return used_bytes_; }
+
+private:
+  void map(std::size_t size) {
+    char *p = nullptr;
+#ifdef STATEFUL_POINTER_HAS_MMAP
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *vp = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    vp = ::mmap(nullptr, size, prot, flags | MAP_HUGETLB, -1, 0);
+    if (vp != MAP_FAILED) {
+      p = static_cast<char *>(vp);
+      huge_page_bytes_ += size;
+    }
+#endif
+    if (!p) {
+      // over-map so that the chunk can be aligned to a huge page boundary,
+      // which transparent huge pages require, then trim the excess
+      const auto n = size + huge_page_size();
+      vp = ::mmap(nullptr, n, prot, flags, -1, 0);
+      if (vp == MAP_FAILED)
+        throw std::bad_alloc();
+      auto first = static_cast<char *>(vp);
+      p = static_cast<char *>(
+          ::boost::alignment::align_up(vp, huge_page_size()));
+      if (p != first)
+        ::munmap(first, p - first);
+      if (first + n != p + size)
+        ::munmap(p + size, first + n - (p + size));
+#ifdef MADV_HUGEPAGE
+      if (::madvise(p, size, MADV_HUGEPAGE) == 0)
+        huge_page_bytes_ += size;
+#endif
+    }
+#else
+    p = static_cast<char *>(
+        ::boost::alignment::aligned_alloc(huge_page_size(), size));
+    if (!p)
+      throw std::bad_alloc();
+#endif
+    chunks_.emplace_back(p, size);
+    mapped_bytes_ += size;
+    cur_ = p;
+    end_ = p + size;
+  }
+
+  static void unmap(char *p, std::size_t size) noexcept {
+#ifdef STATEFUL_POINTER_HAS_MMAP
+    ::munmap(p, size);
+#else
+    (void)size;
+    ::boost::alignment::aligned_free(p);
+#endif
+  }
+
+  std::size_t chunk_size_;
+  char *cur_ = nullptr;
+  char *end_ = nullptr;
+  std::size_t mapped_bytes_ = 0;
+  std::size_t huge_page_bytes_ = 0;
+  std::size_t used_bytes_ = 0;
+  std::vector<std::pair<char *, std::size_t>> chunks_;
+};
+
+/// allocation policy for tagged_ptr which serves memory from a global
+/// hugepage_arena, use different Tag types to get independent arenas
+///
+/// allocate may be called from any thread, it locks a mutex per Tag. Read the
+/// counters of arena() only while no other thread allocates. deallocate never
+/// reuses memory, so a program which keeps making and freeing pointers grows
+/// until it exits. The arena is never destroyed, so that pointers with static
+/// storage duration can still destroy their pointees at exit.
+template <typename Tag = void> struct hugepage_allocator {
+  static hugepage_arena &arena() {
+    static hugepage_arena *a = new hugepage_arena;
+    return *a;
+  }
+
+  static void *allocate(std::size_t alignment, std::size_t size) {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    return arena().allocate(alignment, size);
+  }
+
+  // the memory is not reused
+  static void deallocate(void *) noexcept {}
+};
+
+} // namespace stateful_pointer
+
+#endif
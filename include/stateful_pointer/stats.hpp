@@ -0,0 +1,425 @@
+#ifndef STATEFUL_POINTER_STATS_HPP
+#define STATEFUL_POINTER_STATS_HPP
+
+/// Opt-in allocation statistics. Define STATEFUL_POINTER_ENABLE_STATS for the
+/// whole program, e.g. with -D on the command line of every translation unit,
+/// to turn them on. Otherwise the hooks below are empty and compile away.
+/// Defining it in only some translation units gives inline functions of the
+/// library different bodies, which breaks the one-definition rule.
+///
+/// Counters are kept per thread and summed up when queried. When a thread
+/// ends, its counters are merged into totals kept for finished threads. An
+/// object deleted through a tagged_ptr to a polymorphic base class is counted
+/// for its dynamic type. The hooks never throw, a count which cannot be
+/// recorded for lack of memory is dropped.
+
+#include <cstddef>
+
+#ifdef STATEFUL_POINTER_ENABLE_STATS
+#include "boost/core/demangle.hpp"
+#include "boost/core/typeinfo.hpp"
+#include "boost/cstdint.hpp"
+#include "boost/type_traits/integral_constant.hpp"
+#include "boost/type_traits/is_polymorphic.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#endif
+
+namespace stateful_pointer {
+
+#ifdef STATEFUL_POINTER_ENABLE_STATS
+namespace stats {
+
+/// counters of allocations made by make_tagged for one type and Nbits
+struct allocation_counters {
+  ::boost::uint64_t allocations = 0;
+  ::boost::uint64_t deallocations = 0;
+  /// sum of the sizes passed to the allocator
+  ::boost::uint64_t requested_bytes = 0;
+  /// sum of the sizes rounded up to the alignment required by Nbits
+  ::boost::uint64_t reserved_bytes = 0;
+  /// reserved bytes given back by deallocations
+  ::boost::uint64_t freed_bytes = 0;
+
+  ::boost::uint64_t live_bytes() const noexcept {
+    return reserved_bytes > freed_bytes ? reserved_bytes - freed_bytes : 0;
+  }
+
+  /// bytes lost to over-alignment
+  ::boost::uint64_t padding_bytes() const noexcept {
+    return reserved_bytes - requested_bytes;
+  }
+};
+
+struct allocation_record {
+  std::string type;
+  unsigned nbits;
+  allocation_counters counters;
+};
+
+/// counters of basic_string constructions for one character type
+struct string_counters {
+  ::boost::uint64_t sso_strings = 0;
+  ::boost::uint64_t heap_strings = 0;
+
+  double sso_ratio() const noexcept {
+    const auto n = sso_strings + heap_strings;
+    return n ? static_cast<double>(sso_strings) / n : 0.0;
+  }
+};
+
+struct string_record {
+  std::string type;
+  string_counters counters;
+};
+
+namespace detail {
+enum class kind { allocation, string };
+
+using counter = std::atomic<::boost::uint64_t>;
+
+/// what is counted: type, Nbits and kind
+struct key {
+  const ::boost::core::typeinfo *type;
+  unsigned nbits;
+  kind what;
+
+  bool operator==(const key &o) const noexcept {
+    return *type == *o.type && nbits == o.nbits && what == o.what;
+  }
+};
+
+/// counters of one thread for one key, only written by the owning thread
+struct slot {
+  explicit slot(const key &k) : id(k) {
+    for (auto &v : values)
+      v.store(0, std::memory_order_relaxed);
+  }
+  key id;
+  counter values[5];
+};
+
+/// counters of threads which have finished, for one key
+struct totals {
+  key id;
+  ::boost::uint64_t values[5];
+};
+
+/// size of objects made by make_tagged<U> which are owned by a tagged_ptr to
+/// a base class
+struct origin {
+  key id;
+  std::size_t alignment;
+  std::size_t size;
+};
+
+struct registry {
+  std::mutex mutex;
+  std::vector<slot *> live; // slots of running threads
+  std::vector<totals> retired;
+  std::vector<origin> origins;
+
+  // caller holds the mutex
+  totals &retired_totals(const key &k) {
+    for (auto &t : retired)
+      if (t.id == k)
+        return t;
+    retired.push_back(totals{k, {}});
+    return retired.back();
+  }
+};
+
+/// never destroyed, so that hooks can run during static destruction
+inline registry &get_registry() {
+  static registry *r = new registry;
+  return *r;
+}
+
+/// false once the slots of this thread are retired
+inline bool &thread_alive() noexcept {
+  static thread_local bool alive = true;
+  return alive;
+}
+
+/// owns the slots of one thread, merges them into the retired totals when
+/// the thread ends, so that the registry does not grow with every thread
+struct thread_slots {
+  thread_slots() = default;
+  thread_slots(const thread_slots &) = delete;
+  thread_slots &operator=(const thread_slots &) = delete;
+
+  ~thread_slots() {
+    auto &r = get_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto s : slots) {
+      auto &t = r.retired_totals(s->id);
+      for (unsigned i = 0; i < 5; ++i)
+        t.values[i] += s->values[i].load(std::memory_order_relaxed);
+      r.live.erase(std::find(r.live.begin(), r.live.end(), s));
+      delete s;
+    }
+    thread_alive() = false;
+  }
+
+  slot &get(const key &k) {
+    for (auto s : slots)
+      if (s->id == k)
+        return *s;
+    std::unique_ptr<slot> s(new slot(k));
+    auto &r = get_registry();
+    {
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.live.push_back(s.get());
+    }
+    slots.push_back(s.get());
+    return *s.release();
+  }
+
+  std::vector<slot *> slots;
+};
+
+inline thread_slots &local_slots() {
+  static thread_local thread_slots s;
+  return s;
+}
+
+/// slot of this thread for key k, null after the thread's slots are retired
+inline slot *find_slot(const key &k) {
+  return thread_alive() ? &local_slots().get(k) : nullptr;
+}
+
+template <typename T, unsigned Nbits, kind K> key make_key() noexcept {
+  return key{&BOOST_CORE_TYPEID(T), Nbits, K};
+}
+
+template <typename T, unsigned Nbits, kind K> slot *local_slot() {
+  static thread_local slot *s = nullptr;
+  if (!thread_alive())
+    return nullptr;
+  if (!s)
+    s = find_slot(make_key<T, Nbits, K>());
+  return s;
+}
+
+/// add n to counter i of slot s, or of the retired totals if s is null
+inline void bump(slot *s, const key &k, unsigned i, ::boost::uint64_t n) {
+  if (s) { // single writer, a plain load and store avoid a locked add
+    auto &c = s->values[i];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  } else {
+    auto &r = get_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.retired_totals(k).values[i] += n;
+  }
+}
+
+inline ::boost::uint64_t reserved(std::size_t alignment,
+                                  std::size_t size) noexcept {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+inline void deallocate(const key &k, std::size_t alignment, std::size_t size) {
+  auto s = find_slot(k);
+  bump(s, k, 1, 1);
+  bump(s, k, 4, reserved(alignment, size));
+}
+
+/// remember the size of U, returns true so that it can initialize a static
+inline bool register_origin(const origin &o) noexcept {
+  try {
+    auto &r = get_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &x : r.origins)
+      if (x.id == o.id)
+        return true;
+    r.origins.push_back(o);
+  } catch (...) {
+  }
+  return true;
+}
+
+/// find origin of key k, returns false if it was not registered
+inline bool find_origin(const key &k, origin &o) {
+  auto &r = get_registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for (const auto &x : r.origins)
+    if (x.id == k) {
+      o = x;
+      return true;
+    }
+  return false;
+}
+
+/// call f(key, values) for the counters of all threads
+template <typename F> void for_each_counters(kind what, F f) {
+  auto &r = get_registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  ::boost::uint64_t values[5];
+  for (const auto s : r.live) {
+    if (s->id.what != what)
+      continue;
+    for (unsigned i = 0; i < 5; ++i)
+      values[i] = s->values[i].load(std::memory_order_relaxed);
+    f(s->id, values);
+  }
+  for (const auto &t : r.retired)
+    if (t.id.what == what)
+      f(t.id, t.values);
+}
+} // namespace detail
+
+/// aggregate allocation counters of all threads, one record per type and Nbits
+inline std::vector<allocation_record> allocations() {
+  std::vector<allocation_record> result;
+  detail::for_each_counters(
+      detail::kind::allocation,
+      [&result](const detail::key &k, const ::boost::uint64_t *v) {
+        const auto name = ::boost::core::demangled_name(*k.type);
+        auto it = result.begin();
+        while (it != result.end() &&
+               !(it->type == name && it->nbits == k.nbits))
+          ++it;
+        if (it == result.end())
+          it = result.insert(it, allocation_record{name, k.nbits, {}});
+        auto &c = it->counters;
+        c.allocations += v[0];
+        c.deallocations += v[1];
+        c.requested_bytes += v[2];
+        c.reserved_bytes += v[3];
+        c.freed_bytes += v[4];
+      });
+  return result;
+}
+
+/// aggregate string counters of all threads, one record per character type
+inline std::vector<string_record> strings() {
+  std::vector<string_record> result;
+  detail::for_each_counters(
+      detail::kind::string,
+      [&result](const detail::key &k, const ::boost::uint64_t *v) {
+        const auto name = ::boost::core::demangled_name(*k.type);
+        auto it = result.begin();
+        while (it != result.end() && it->type != name)
+          ++it;
+        if (it == result.end())
+          it = result.insert(it, string_record{name, {}});
+        it->counters.sso_strings += v[0];
+        it->counters.heap_strings += v[1];
+      });
+  return result;
+}
+} // namespace stats
+
+namespace detail {
+template <typename T, unsigned Nbits>
+void stats_allocate(std::size_t alignment, std::size_t size) noexcept {
+  using namespace stats::detail;
+  try {
+    const auto k = make_key<T, Nbits, kind::allocation>();
+    auto s = local_slot<T, Nbits, kind::allocation>();
+    bump(s, k, 0, 1);
+    bump(s, k, 2, size);
+    bump(s, k, 3, reserved(alignment, size));
+  } catch (...) {
+  }
+}
+
+template <typename T, unsigned Nbits>
+void stats_deallocate(std::size_t alignment, std::size_t size) noexcept {
+  using namespace stats::detail;
+  try {
+    const auto k = make_key<T, Nbits, kind::allocation>();
+    auto s = local_slot<T, Nbits, kind::allocation>();
+    bump(s, k, 1, 1);
+    bump(s, k, 4, reserved(alignment, size));
+  } catch (...) {
+  }
+}
+
+/// objects made by make_tagged<U> are now owned by a tagged_ptr to a base,
+/// remember the size of U once
+template <typename U, unsigned Nbits>
+void stats_convert(std::size_t alignment) noexcept {
+  using namespace stats::detail;
+  if (::boost::is_polymorphic<U>::value) {
+    static const bool registered = register_origin(
+        origin{make_key<U, Nbits, kind::allocation>(), alignment, sizeof(U)});
+    (void)registered;
+  }
+}
+
+// the dynamic type of p is only known if T is polymorphic
+template <typename T, unsigned Nbits>
+bool stats_deallocate_dynamic(const T *, ::boost::false_type) {
+  return false;
+}
+
+template <typename T, unsigned Nbits>
+bool stats_deallocate_dynamic(const T *p, ::boost::true_type) {
+#ifdef BOOST_NO_RTTI
+  (void)p;
+  return false;
+#else
+  using namespace stats::detail;
+  const auto &t = typeid(*p);
+  origin o;
+  if (t == typeid(T) || !find_origin(key{&t, Nbits, kind::allocation}, o))
+    return false;
+  deallocate(o.id, o.alignment, o.size);
+  return true;
+#endif
+}
+
+/// object p of static type T is about to be freed, count it for its dynamic
+/// type; frees through a pointer to the made type do not take a lock
+template <typename T, unsigned Nbits>
+void stats_deallocate_object(const T *p, std::size_t alignment,
+                             std::size_t size) noexcept {
+  try {
+    if (stats_deallocate_dynamic<T, Nbits>(
+            p, ::boost::integral_constant<
+                   bool, ::boost::is_polymorphic<T>::value>()))
+      return;
+  } catch (...) {
+  }
+  stats_deallocate<T, Nbits>(alignment, size);
+}
+
+template <typename TChar> void stats_string(bool sso) noexcept {
+  using namespace stats::detail;
+  try {
+    const auto k = make_key<TChar, 0, kind::string>();
+    bump(local_slot<TChar, 0, kind::string>(), k, sso ? 0 : 1, 1);
+  } catch (...) {
+  }
+}
+} // namespace detail
+
+#else
+
+namespace detail {
+template <typename T, unsigned Nbits>
+void stats_allocate(std::size_t, std::size_t) noexcept {}
+
+template <typename T, unsigned Nbits>
+void stats_deallocate(std::size_t, std::size_t) noexcept {}
+
+template <typename U, unsigned Nbits>
+void stats_convert(std::size_t) noexcept {}
+
+template <typename T, unsigned Nbits>
+void stats_deallocate_object(const T *, std::size_t, std::size_t) noexcept {}
+
+template <typename TChar> void stats_string(bool) noexcept {}
+} // namespace detail
+
+#endif
+
+} // namespace stateful_pointer
+
+#endif
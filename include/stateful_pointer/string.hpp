@@ -2,14 +2,22 @@
 #define STATEFUL_POINTER_STRING_HPP
 
 #include "boost/cstdint.hpp"
-#include "stateful_pointer/tagged_ptr.hpp"
-// #include "boost/assert.hpp"
-// #include "boost/type_traits.hpp"
+#include "boost/predef/other/endian.h"
+#include "boost/type_traits.hpp"
 #include "boost/utility/binary.hpp"
+#include "stateful_pointer/tagged_ptr.hpp"
 #include <algorithm>
 #include <cstddef>
 #include <ostream>
 #include <stdexcept>
+#include <utility>
+
+// bit 63 of user space pointers is clear on x86-64, other 64 bit platforms
+// may keep a tag in the top byte (AArch64 TBI and MTE)
+#if BOOST_ENDIAN_LITTLE_BYTE && UINTPTR_MAX == 0xFFFFFFFFFFFFFFFF &&           \
+    (defined(__x86_64__) || defined(_M_X64))
+#define STATEFUL_POINTER_HAS_PACKED_SSO 1
+#endif
 
 namespace stateful_pointer {
 
@@ -19,10 +27,87 @@ template <typename T, typename = decltype(std::begin(std::declval<T &>()),
 struct is_sequence {};
 } // namespace detail
 
-template <typename TChar> class basic_string {
+/// small string encodings, selected by the second argument of basic_string
+
+/// the first character lane holds the size, the characters start at the
+/// second lane; bit 0 of the pointer marks heap mode
+struct sso_size_lane {};
+
+/// all character lanes hold characters, the string ends at the first null
+/// lane; the highest pointer bit marks heap mode. Strings which contain a
+/// null character or whose last inline character uses the highest bit are
+/// stored on the heap. Same as sso_size_lane except on x86-64.
+struct sso_packed {};
+
+namespace detail {
+template <typename Encoding, typename TChar> struct sso_traits;
+
+template <typename TChar> struct sso_traits<sso_size_lane, TChar> {
+  using bits_type = ::boost::uintptr_t;
+  static constexpr std::size_t N = sizeof(void *) / sizeof(TChar);
+  static constexpr std::size_t first = 1; // lane of first inline character
+  static constexpr bits_type heap_bit = 1;
+  static constexpr bits_type size_mask = BOOST_BINARY(11111110);
+
+  template <typename It> static bool fits_range(It, std::size_t n) noexcept {
+    return n < N;
+  }
+  static bool fits(std::size_t n, TChar) noexcept { return n < N; }
+
+  static std::size_t size(bits_type w) noexcept {
+    return (w & size_mask) >> 1;
+  }
+  static void size(bits_type &w, std::size_t n) noexcept { w |= n << 1; }
+};
+
+#ifdef STATEFUL_POINTER_HAS_PACKED_SSO
+template <typename TChar> struct sso_traits<sso_packed, TChar> {
+  using bits_type = ::boost::uintptr_t;
+  static constexpr std::size_t N = sizeof(void *) / sizeof(TChar);
+  static constexpr std::size_t first = 0;
+  static constexpr unsigned lane_bits = 8 * sizeof(TChar);
+  static constexpr bits_type heap_bit = bits_type(1) << 63;
+
+  // the highest bit of the last lane is the heap bit
+  static bool fits_lane(TChar c, bool last) noexcept {
+    using uchar = typename ::boost::make_unsigned<TChar>::type;
+    return c != 0 && !(last && static_cast<uchar>(c) >> (lane_bits - 1));
+  }
+  template <typename It> static bool fits_range(It it, std::size_t n) {
+    if (n > N)
+      return false;
+    for (std::size_t i = 0; i < n; ++i, ++it)
+      if (!fits_lane(*it, i + 1 == N))
+        return false;
+    return true;
+  }
+  static bool fits(std::size_t n, TChar c) noexcept {
+    return n == 0 || (n <= N && fits_lane(c, n == N));
+  }
+
+  static std::size_t size(bits_type w) noexcept {
+    const bits_type lane_mask = ~bits_type(0) >> (64 - lane_bits);
+    std::size_t n = 0;
+    while (n < N && (w & lane_mask)) {
+      w >>= lane_bits - 1; // two shifts, lane_bits may be 64
+      w >>= 1;
+      ++n;
+    }
+    return n;
+  }
+  static void size(bits_type &, std::size_t) noexcept {}
+};
+#else
+template <typename TChar>
+struct sso_traits<sso_packed, TChar> : sso_traits<sso_size_lane, TChar> {};
+#endif
+} // namespace detail
+
+template <typename TChar, typename Encoding = sso_size_lane>
+class basic_string {
   using tagged_ptr_t = tagged_ptr<TChar[], 1>;
   using bits_type = typename tagged_ptr_t::bits_type;
-  static constexpr unsigned N = sizeof(void *) / sizeof(TChar);
+  using traits = detail::sso_traits<Encoding, TChar>;
 
 public:
   using pos_type = std::size_t;
@@ -37,17 +122,18 @@ public:
   constexpr basic_string() noexcept {}
 
   basic_string(pos_type count, value_type ch) {
-    if (N > 0 && count < N) { // small string optimisation
-      auto cp = reinterpret_cast<pointer>(&value) + 1;
+    if (traits::fits(count, ch)) { // small string optimisation
+      auto cp = reinterpret_cast<pointer>(&value) + traits::first;
       std::fill_n(cp, count, ch);
-      reinterpret_cast<bits_type &>(value) |= count << 1;
-      // value.bit(0) remains false
+      traits::size(word(), count);
+      // heap bit remains false
+      detail::stats_string<TChar>(true);
     } else { // normal use
-      value = make_tagged<value_type[], 1>(count + 1);
-      value.bit(0, true);
-      auto cp = value.get();
+      allocate(count + 1);
+      auto cp = heap_data();
       std::fill_n(cp, count, ch);
       *(cp + count) = 0;
+      detail::stats_string<TChar>(false);
     }
   }
 
@@ -79,35 +165,36 @@ public:
     assign_impl(first, last);
   }
 
+  basic_string(basic_string &&other) noexcept : value(std::move(other.value)) {}
+
+  basic_string &operator=(basic_string &&other) noexcept {
+    value.swap(other.value); // other releases our old memory
+    return *this;
+  }
+
   ~basic_string() {
-    if (!value.bit(0)) { // we are in small string optimisation mode
-      // prevent tagged_ptr destructor from running
-      reinterpret_cast<bits_type &>(value) = 0;
-    }
+    if (heap()) // tagged_ptr destructor frees memory
+      word() &= ~traits::heap_bit;
+    else // small string optimisation mode
+      word() = 0; // prevent tagged_ptr destructor from running
   }
 
   const_iterator begin() const noexcept {
-    return begin_impl<const_iterator>(value);
+    return begin_impl<const_iterator>(*this);
   }
 
   const_iterator end() const noexcept {
-    return end_impl<const_iterator>(value);
+    return end_impl<const_iterator>(*this);
   }
 
-  iterator begin() noexcept { return begin_impl<iterator>(value); }
+  iterator begin() noexcept { return begin_impl<iterator>(*this); }
 
-  iterator end() noexcept { return end_impl<iterator>(value); }
+  iterator end() noexcept { return end_impl<iterator>(*this); }
 
-  bool empty() const noexcept {
-    return reinterpret_cast<const bits_type &>(value) == 0 || size() == 0;
-  }
+  bool empty() const noexcept { return word() == 0 || size() == 0; }
 
   pos_type size() const noexcept {
-    if (value.bit(0)) {
-      auto size = value.size();
-      return size ? size - 1 : 0;
-    }
-    return (reinterpret_cast<const bits_type &>(value) & size_mask) >> 1;
+    return heap() ? heap_size() : traits::size(word());
   }
 
   pos_type length() const noexcept { return size(); }
@@ -138,53 +225,79 @@ public:
   reference operator[](pos_type i) { return *(begin() + i); }
 
 private:
-  static constexpr bits_type size_mask = BOOST_BINARY(11111110);
+  bits_type &word() noexcept { return reinterpret_cast<bits_type &>(value); }
+
+  const bits_type &word() const noexcept {
+    return reinterpret_cast<const bits_type &>(value);
+  }
+
+  bool heap() const noexcept { return word() & traits::heap_bit; }
+
+  pointer heap_data() const noexcept {
+    return reinterpret_cast<pointer>(word() & ~(traits::heap_bit | 1));
+  }
+
+  pos_type heap_size() const noexcept {
+    tagged_ptr_t t; // non-owning, without the heap bit
+    reinterpret_cast<bits_type &>(t) = word() & ~traits::heap_bit;
+    const auto size = t.size();
+    reinterpret_cast<bits_type &>(t) = 0;
+    return size ? size - 1 : 0;
+  }
+
+  void allocate(pos_type n) {
+    value = make_tagged<value_type[], 1>(n);
+    word() |= traits::heap_bit; // marks normal pointer use
+  }
 
   template <typename InputIt> void assign_impl(InputIt first, InputIt last) {
     const auto n = std::distance(first, last);
 
-    if (value.bit(0) && n <= size()) {
+    if (heap() && pos_type(n) <= size()) {
       // normal pointer, reuse allocated memory
-      auto cp = value.get();
+      auto cp = heap_data();
       std::copy(first, last, cp);
       *(cp + n) = 0;
       return;
     }
 
-    if (!value.bit(0)) {
+    if (!heap()) {
       // small string optimisation: characters stored inside pointer memory
-      reinterpret_cast<bits_type &>(value) = 0; // wipe memory
-      if (N > 0 && n < N) {
+      word() = 0; // wipe memory
+      if (traits::fits_range(first, n)) {
         // small string optimisation remains possible
-        auto cp = reinterpret_cast<pointer>(&value) + 1;
+        auto cp = reinterpret_cast<pointer>(&value) + traits::first;
         std::copy(first, last, cp);
-        reinterpret_cast<bits_type &>(value) |= n << 1;
-        // value.bit(0) remains false
+        traits::size(word(), n);
+        // heap bit remains false
+        detail::stats_string<TChar>(true);
         return;
       }
     }
 
     // allocate new memory
-    // value.bit(0) == true marks normal pointer use
-    value = make_tagged<value_type[], 1>(n + 1);
-    value.bit(0, true);
-    auto cp = value.get();
+    allocate(n + 1);
+    auto cp = heap_data();
     std::copy(first, last, cp);
     *(cp + n) = 0;
+    detail::stats_string<TChar>(false);
   }
 
-  template <typename It, typename T> static It begin_impl(T &t) noexcept {
-    return t.bit(0) ? t.get() : reinterpret_cast<It>(&t) + 1;
+  template <typename It, typename S> static It begin_impl(S &s) noexcept {
+    return s.heap() ? s.heap_data()
+                    : reinterpret_cast<It>(&s.value) + traits::first;
   }
 
-  template <typename It, typename T> static It end_impl(T &t) noexcept {
-    if (t.bit(0)) {
-      const auto n = t.size();
-      return t.get() + (n ? n - 1 : 0);
-    } else {
-      const auto n = (reinterpret_cast<const bits_type &>(t) & size_mask) >> 1;
-      return reinterpret_cast<It>(&t) + 1 + n;
-    }
+  template <typename It, typename S> static It end_impl(S &s) noexcept {
+    if (s.heap())
+      return s.heap_data() + s.heap_size();
+    return reinterpret_cast<It>(&s.value) + traits::first +
+           traits::size(s.word());
+  }
+
+  friend bool operator<(const basic_string &a, const basic_string &b) {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(),
+                                        b.end());
   }
 
   friend std::ostream &operator<<(std::ostream &os, const basic_string &s) {
@@ -198,6 +311,9 @@ private:
 
 using string = basic_string<char>;
 using wstring = basic_string<wchar_t>;
+/// inline capacity is 4 UTF-16 or 2 UTF-32 code units on 64 bit systems
+using u16string = basic_string<char16_t, sso_packed>;
+using u32string = basic_string<char32_t, sso_packed>;
 } // namespace stateful_pointer
 
 #endif
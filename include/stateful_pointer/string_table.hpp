@@ -0,0 +1,304 @@
+#ifndef STATEFUL_POINTER_STRING_TABLE_HPP
+#define STATEFUL_POINTER_STRING_TABLE_HPP
+
+/// File format for many basic_string values which is loaded with mmap.
+///
+/// The file starts with a header, followed by one word per string and a blob.
+/// The word of a short string is the inline word of basic_string, stored
+/// verbatim. The word of a long string has bit 0 set and holds the distance
+/// in bytes from the word to the string record in the blob. A record is the
+/// size as a 64 bit number followed by the characters and a terminating null.
+/// Since all offsets are relative, the file can be mapped at any address.
+
+#include "boost/cstdint.hpp"
+#include "boost/type_traits.hpp"
+#include "stateful_pointer/string.hpp"
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STATEFUL_POINTER_HAS_MMAP 1
+#endif
+
+namespace stateful_pointer {
+
+namespace detail {
+struct string_table_header {
+  char magic[8];
+  ::boost::uint32_t version;
+  ::boost::uint32_t byte_order;
+  ::boost::uint32_t char_size;
+  ::boost::uint32_t word_size;
+  ::boost::uint64_t count;
+  ::boost::uint64_t blob_size;
+};
+
+constexpr char string_table_magic[8] = {'S', 'P', 'S', 'T', 'R', 'T', 'A', 'B'};
+constexpr ::boost::uint32_t string_table_version = 1;
+constexpr ::boost::uint32_t string_table_byte_order = 0x01020304;
+
+template <typename TChar> std::size_t string_record_size(std::size_t n) {
+  const auto bytes = sizeof(::boost::uint64_t) + (n + 1) * sizeof(TChar);
+  const auto a = sizeof(::boost::uint64_t);
+  return (bytes + a - 1) / a * a;
+}
+
+/// read-only copy of a whole file, mapped where mmap is available
+class file_mapping {
+public:
+  /// throws std::runtime_error if the file cannot be read
+  explicit file_mapping(const char *path) {
+#ifdef STATEFUL_POINTER_HAS_MMAP
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("cannot open string table");
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      auto p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        data_ = static_cast<const char *>(p);
+        size_ = st.st_size;
+      }
+    }
+    ::close(fd);
+    if (!data_)
+      throw std::runtime_error("cannot map string table");
+#else
+    std::ifstream is(path, std::ios::binary);
+    is.seekg(0, std::ios::end);
+    const auto n = static_cast<std::size_t>(is.tellg());
+    is.seekg(0);
+    buffer_.resize((n + sizeof(::boost::uint64_t) - 1) /
+                   sizeof(::boost::uint64_t));
+    if (!is.read(reinterpret_cast<char *>(buffer_.data()), n))
+      throw std::runtime_error("cannot read string table");
+    data_ = reinterpret_cast<const char *>(buffer_.data());
+    size_ = n;
+#endif
+  }
+
+  file_mapping(const file_mapping &) = delete;
+  file_mapping &operator=(const file_mapping &) = delete;
+
+  ~file_mapping() {
+#ifdef STATEFUL_POINTER_HAS_MMAP
+    ::munmap(const_cast<char *>(data_), size_);
+#endif
+  }
+
+  const char *data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+#ifndef STATEFUL_POINTER_HAS_MMAP
+  std::vector<::boost::uint64_t> buffer_;
+#endif
+};
+} // namespace detail
+
+/// read-only string inside a mapped string table, has the size of a pointer
+///
+/// It can only be used by reference, because long strings are found relative
+/// to the address of the view.
+template <typename TChar> class basic_mapped_string {
+  using bits_type = ::boost::uintptr_t;
+  static constexpr bits_type size_mask = 0xFE;
+
+public:
+  using pos_type = std::size_t;
+  using value_type = TChar;
+  using const_pointer = const value_type *;
+  using const_reference = const value_type &;
+  using const_iterator = const_pointer;
+
+  basic_mapped_string(const basic_mapped_string &) = delete;
+  basic_mapped_string &operator=(const basic_mapped_string &) = delete;
+
+  const_iterator begin() const noexcept {
+    return value & 1 ? reinterpret_cast<const_pointer>(record() + 1)
+                     : reinterpret_cast<const_pointer>(&value) + 1;
+  }
+
+  const_iterator end() const noexcept { return begin() + size(); }
+
+  pos_type size() const noexcept {
+    return value & 1 ? *record() : (value & size_mask) >> 1;
+  }
+
+  pos_type length() const noexcept { return size(); }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  const_reference operator[](pos_type i) const { return *(begin() + i); }
+
+  bool operator==(const value_type *s) const {
+    auto send = s;
+    while (*send++)
+      ;
+    --send;
+    return (std::distance(begin(), end()) == std::distance(s, send)) &&
+           std::equal(begin(), end(), s);
+  }
+
+  template <typename Container, typename = detail::is_sequence<Container>>
+  bool operator==(const Container &c) const {
+    auto cfirst = std::begin(c);
+    auto cend = std::end(c);
+    return (std::distance(begin(), end()) == std::distance(cfirst, cend)) &&
+           std::equal(begin(), end(), cfirst);
+  }
+
+private:
+  const ::boost::uint64_t *record() const noexcept {
+    return reinterpret_cast<const ::boost::uint64_t *>(
+        reinterpret_cast<const char *>(this) + (value >> 1));
+  }
+
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const basic_mapped_string &s) {
+    for (const auto &ch : s)
+      os << ch;
+    return os;
+  }
+
+  bits_type value;
+};
+
+/// write the strings in [first, last) as a string table to os, throws
+/// std::runtime_error if writing fails
+template <typename ForwardIt> void write_string_table(std::ostream &os,
+                                                      ForwardIt first,
+                                                      ForwardIt last) {
+  using string_type = typename std::iterator_traits<ForwardIt>::value_type;
+  using char_type = typename string_type::value_type;
+  using word = ::boost::uintptr_t;
+  static_assert(::boost::is_same<string_type, basic_string<char_type>>::value,
+                "strings must use the default encoding");
+  constexpr std::size_t N = sizeof(word) / sizeof(char_type);
+
+  detail::string_table_header h;
+  std::memcpy(h.magic, detail::string_table_magic, sizeof(h.magic));
+  h.version = detail::string_table_version;
+  h.byte_order = detail::string_table_byte_order;
+  h.char_size = sizeof(char_type);
+  h.word_size = sizeof(word);
+  h.count = std::distance(first, last);
+  h.blob_size = 0;
+  for (auto it = first; it != last; ++it)
+    if (it->size() >= N)
+      h.blob_size += detail::string_record_size<char_type>(it->size());
+  os.write(reinterpret_cast<const char *>(&h), sizeof(h));
+
+  // distance from the current word to the next record in the blob
+  ::boost::uint64_t offset = h.count * sizeof(word);
+  std::vector<word> buffer;
+  buffer.reserve(4096);
+  for (auto it = first; it != last; ++it) {
+    word w;
+    if (it->size() < N) {
+      std::memcpy(&w, &*it, sizeof(w)); // inline word of basic_string
+    } else {
+      w = (offset << 1) | 1;
+      offset += detail::string_record_size<char_type>(it->size());
+    }
+    offset -= sizeof(word);
+    buffer.push_back(w);
+    if (buffer.size() == buffer.capacity()) {
+      os.write(reinterpret_cast<const char *>(buffer.data()),
+               buffer.size() * sizeof(word));
+      buffer.clear();
+    }
+  }
+  os.write(reinterpret_cast<const char *>(buffer.data()),
+           buffer.size() * sizeof(word));
+
+  std::vector<char> record;
+  for (auto it = first; it != last; ++it) {
+    const std::size_t n = it->size();
+    if (n < N)
+      continue;
+    record.assign(detail::string_record_size<char_type>(n), 0);
+    const ::boost::uint64_t size = n;
+    std::memcpy(record.data(), &size, sizeof(size));
+    std::memcpy(record.data() + sizeof(size), &*it->begin(),
+                n * sizeof(char_type));
+    os.write(record.data(), record.size());
+  }
+  if (!os)
+    throw std::runtime_error("writing string table failed");
+}
+
+/// read-only string table which is mapped into memory, loading does not
+/// allocate or copy per string
+template <typename TChar> class basic_string_table {
+public:
+  using value_type = basic_mapped_string<TChar>;
+  using const_reference = const value_type &;
+  using const_iterator = const value_type *;
+  using pos_type = std::size_t;
+
+  /// map file at path, throws std::runtime_error if it cannot be read or is
+  /// not a string table for TChar on this platform
+  explicit basic_string_table(const char *path) : file_(path) { check(); }
+
+  basic_string_table(const basic_string_table &) = delete;
+  basic_string_table &operator=(const basic_string_table &) = delete;
+
+  pos_type size() const noexcept { return header().count; }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  const_iterator begin() const noexcept {
+    return reinterpret_cast<const_iterator>(file_.data() +
+                                            sizeof(header_type));
+  }
+
+  const_iterator end() const noexcept { return begin() + size(); }
+
+  const_reference operator[](pos_type i) const { return *(begin() + i); }
+
+private:
+  using header_type = detail::string_table_header;
+
+  const header_type &header() const noexcept {
+    return *reinterpret_cast<const header_type *>(file_.data());
+  }
+
+  void check() const {
+    const auto &h = header();
+    const auto size = file_.size();
+    if (size < sizeof(h) ||
+        std::memcmp(h.magic, detail::string_table_magic, sizeof(h.magic)))
+      throw std::runtime_error("not a string table");
+    if (h.version != detail::string_table_version ||
+        h.byte_order != detail::string_table_byte_order ||
+        h.char_size != sizeof(TChar) || h.word_size != sizeof(void *))
+      throw std::runtime_error("string table has incompatible format");
+    // checked one at a time, so that huge values in the header cannot wrap
+    const auto words = size - sizeof(h);
+    if (h.count > words / sizeof(void *) ||
+        h.blob_size > words - h.count * sizeof(void *))
+      throw std::runtime_error("string table is truncated");
+  }
+
+  detail::file_mapping file_;
+};
+
+using mapped_string = basic_mapped_string<char>;
+using string_table = basic_string_table<char>;
+using wstring_table = basic_string_table<wchar_t>;
+
+} // namespace stateful_pointer
+
+#endif
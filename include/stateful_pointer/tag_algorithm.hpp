@@ -0,0 +1,376 @@
+#ifndef STATEFUL_POINTER_TAG_ALGORITHM_HPP
+#define STATEFUL_POINTER_TAG_ALGORITHM_HPP
+
+/// Bulk queries and updates of the tag bits in contiguous arrays of
+/// tagged_ptr, for example std::vector<tagged_ptr<T, Nbits>>. An element
+/// matches if (p.bits() & mask) == value. On x86-64 with GCC or Clang, the
+/// best of AVX-512, AVX2 or a scalar loop is selected at runtime.
+
+#include "boost/cstdint.hpp"
+#include "stateful_pointer/tagged_ptr.hpp"
+#include <cstddef>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+#define STATEFUL_POINTER_HAS_X86_DISPATCH 1
+#endif
+
+namespace stateful_pointer {
+
+namespace detail {
+namespace simd {
+using word = ::boost::uintptr_t;
+
+struct scalar {
+  static std::size_t count(const word *p, std::size_t n, word mask,
+                           word value) noexcept {
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < n; ++i)
+      c += (p[i] & mask) == value;
+    return c;
+  }
+
+  /// index of first element whose match state is m, or n
+  static std::size_t find(const word *p, std::size_t n, word mask, word value,
+                          bool m) noexcept {
+    for (std::size_t i = 0; i < n; ++i)
+      if (((p[i] & mask) == value) == m)
+        return i;
+    return n;
+  }
+
+  /// write pointer part of matching elements to out, return number written
+  static std::size_t gather(const word *p, std::size_t n, word mask,
+                            word value, word ptr_mask, word *out) noexcept {
+    auto o = out;
+    for (std::size_t i = 0; i < n; ++i)
+      if ((p[i] & mask) == value)
+        *o++ = p[i] & ptr_mask;
+    return o - out;
+  }
+
+  static void set(word *p, std::size_t n, word bits) noexcept {
+    for (std::size_t i = 0; i < n; ++i)
+      p[i] |= bits;
+  }
+
+  static void clear(word *p, std::size_t n, word bits) noexcept {
+    for (std::size_t i = 0; i < n; ++i)
+      p[i] &= ~bits;
+  }
+};
+
+#ifdef STATEFUL_POINTER_HAS_X86_DISPATCH
+struct avx2 {
+  __attribute__((target("avx2"))) static __m256i load(const word *p) noexcept {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+
+  __attribute__((target("avx2"))) static std::size_t
+  count(const word *p, std::size_t n, word mask, word value) noexcept {
+    const auto m = _mm256_set1_epi64x(mask);
+    const auto v = _mm256_set1_epi64x(value);
+    auto acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const auto x = load(p + i);
+      // matching lanes are -1, so subtracting counts them
+      const auto eq = _mm256_cmpeq_epi64(_mm256_and_si256(x, m), v);
+      acc = _mm256_sub_epi64(acc, eq);
+    }
+    alignas(32) ::boost::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+           scalar::count(p + i, n - i, mask, value);
+  }
+
+  __attribute__((target("avx2"))) static std::size_t
+  find(const word *p, std::size_t n, word mask, word value, bool m) noexcept {
+    const auto vm = _mm256_set1_epi64x(mask);
+    const auto vv = _mm256_set1_epi64x(value);
+    const unsigned flip = m ? 0 : 0xF;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const auto x = load(p + i);
+      const auto eq = _mm256_cmpeq_epi64(_mm256_and_si256(x, vm), vv);
+      const unsigned k = _mm256_movemask_pd(_mm256_castsi256_pd(eq)) ^ flip;
+      if (k)
+        return i + __builtin_ctz(k);
+    }
+    return i + scalar::find(p + i, n - i, mask, value, m);
+  }
+
+  __attribute__((target("avx2"))) static std::size_t
+  gather(const word *p, std::size_t n, word mask, word value, word ptr_mask,
+         word *out) noexcept {
+    const auto vm = _mm256_set1_epi64x(mask);
+    const auto vv = _mm256_set1_epi64x(value);
+    auto o = out;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const auto x = load(p + i);
+      const auto eq = _mm256_cmpeq_epi64(_mm256_and_si256(x, vm), vv);
+      unsigned k = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+      for (; k; k &= k - 1)
+        *o++ = p[i + __builtin_ctz(k)] & ptr_mask;
+    }
+    o += scalar::gather(p + i, n - i, mask, value, ptr_mask, o);
+    return o - out;
+  }
+
+  __attribute__((target("avx2"))) static void set(word *p, std::size_t n,
+                                                  word bits) noexcept {
+    const auto b = _mm256_set1_epi64x(bits);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const auto q = reinterpret_cast<__m256i *>(p + i);
+      _mm256_storeu_si256(q, _mm256_or_si256(_mm256_loadu_si256(q), b));
+    }
+    scalar::set(p + i, n - i, bits);
+  }
+
+  __attribute__((target("avx2"))) static void clear(word *p, std::size_t n,
+                                                    word bits) noexcept {
+    const auto b = _mm256_set1_epi64x(bits);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const auto q = reinterpret_cast<__m256i *>(p + i);
+      _mm256_storeu_si256(q, _mm256_andnot_si256(b, _mm256_loadu_si256(q)));
+    }
+    scalar::clear(p + i, n - i, bits);
+  }
+};
+
+struct avx512 {
+  __attribute__((target("avx512f"))) static std::size_t
+  count(const word *p, std::size_t n, word mask, word value) noexcept {
+    const auto m = _mm512_set1_epi64(mask);
+    const auto v = _mm512_set1_epi64(value);
+    std::size_t c = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const auto x = _mm512_loadu_si512(p + i);
+      c += __builtin_popcount(
+          _mm512_cmpeq_epi64_mask(_mm512_and_si512(x, m), v));
+    }
+    return c + scalar::count(p + i, n - i, mask, value);
+  }
+
+  __attribute__((target("avx512f"))) static std::size_t
+  find(const word *p, std::size_t n, word mask, word value, bool m) noexcept {
+    const auto vm = _mm512_set1_epi64(mask);
+    const auto vv = _mm512_set1_epi64(value);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const auto x = _mm512_and_si512(_mm512_loadu_si512(p + i), vm);
+      const unsigned k = m ? _mm512_cmpeq_epi64_mask(x, vv)
+                           : _mm512_cmpneq_epi64_mask(x, vv);
+      if (k)
+        return i + __builtin_ctz(k);
+    }
+    return i + scalar::find(p + i, n - i, mask, value, m);
+  }
+
+  __attribute__((target("avx512f"))) static std::size_t
+  gather(const word *p, std::size_t n, word mask, word value, word ptr_mask,
+         word *out) noexcept {
+    const auto vm = _mm512_set1_epi64(mask);
+    const auto vv = _mm512_set1_epi64(value);
+    const auto vp = _mm512_set1_epi64(ptr_mask);
+    auto o = out;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      const auto x = _mm512_loadu_si512(p + i);
+      const auto k = _mm512_cmpeq_epi64_mask(_mm512_and_si512(x, vm), vv);
+      _mm512_mask_compressstoreu_epi64(o, k, _mm512_and_si512(x, vp));
+      o += __builtin_popcount(k);
+    }
+    o += scalar::gather(p + i, n - i, mask, value, ptr_mask, o);
+    return o - out;
+  }
+
+  __attribute__((target("avx512f"))) static void set(word *p, std::size_t n,
+                                                     word bits) noexcept {
+    const auto b = _mm512_set1_epi64(bits);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_si512(p + i, _mm512_or_si512(_mm512_loadu_si512(p + i), b));
+    scalar::set(p + i, n - i, bits);
+  }
+
+  __attribute__((target("avx512f"))) static void clear(word *p, std::size_t n,
+                                                       word bits) noexcept {
+    const auto b = _mm512_set1_epi64(bits);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      _mm512_storeu_si512(p + i,
+                          _mm512_andnot_si512(b, _mm512_loadu_si512(p + i)));
+    scalar::clear(p + i, n - i, bits);
+  }
+};
+#else
+using avx2 = scalar;
+using avx512 = scalar;
+#endif
+
+enum class isa { scalar, avx2, avx512 };
+
+inline isa detect() noexcept {
+#ifdef STATEFUL_POINTER_HAS_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return isa::avx512;
+  if (__builtin_cpu_supports("avx2"))
+    return isa::avx2;
+#endif
+  return isa::scalar;
+}
+
+/// instruction set used by the algorithms, detected once
+inline isa best() noexcept {
+  static const isa i = detect();
+  return i;
+}
+} // namespace simd
+
+template <typename T, unsigned Nbits, typename A>
+const simd::word *words(const tagged_ptr<T, Nbits, A> *p) noexcept {
+  static_assert(sizeof(tagged_ptr<T, Nbits, A>) == sizeof(simd::word),
+                "tagged_ptr must have the size of a pointer");
+  return reinterpret_cast<const simd::word *>(p);
+}
+
+template <typename T, unsigned Nbits, typename A>
+simd::word *words(tagged_ptr<T, Nbits, A> *p) noexcept {
+  return reinterpret_cast<simd::word *>(p);
+}
+} // namespace detail
+
+/// number of elements in [first, last) with (bits() & mask) == value
+template <typename T, unsigned Nbits, typename A>
+std::size_t count_bits(const tagged_ptr<T, Nbits, A> *first,
+                       const tagged_ptr<T, Nbits, A> *last,
+                       typename tagged_ptr<T, Nbits, A>::bits_type mask,
+                       typename tagged_ptr<T, Nbits, A>::bits_type value) {
+  using namespace detail::simd;
+  mask &= ~detail::make_ptr_mask(Nbits);
+  const auto p = detail::words(first);
+  const std::size_t n = last - first;
+  switch (best()) {
+  case isa::avx512:
+    return avx512::count(p, n, mask, value);
+  case isa::avx2:
+    return avx2::count(p, n, mask, value);
+  default:
+    return scalar::count(p, n, mask, value);
+  }
+}
+
+/// first element in [first, last) with (bits() & mask) == value, or last
+template <typename T, unsigned Nbits, typename A>
+tagged_ptr<T, Nbits, A> *
+find_bits(tagged_ptr<T, Nbits, A> *first, tagged_ptr<T, Nbits, A> *last,
+          typename tagged_ptr<T, Nbits, A>::bits_type mask,
+          typename tagged_ptr<T, Nbits, A>::bits_type value,
+          bool match = true) {
+  using namespace detail::simd;
+  mask &= ~detail::make_ptr_mask(Nbits);
+  const auto p = detail::words(first);
+  const std::size_t n = last - first;
+  switch (best()) {
+  case isa::avx512:
+    return first + avx512::find(p, n, mask, value, match);
+  case isa::avx2:
+    return first + avx2::find(p, n, mask, value, match);
+  default:
+    return first + scalar::find(p, n, mask, value, match);
+  }
+}
+
+/// reorder [first, last) so that elements with (bits() & mask) == value come
+/// first, return the end of that group; like std::partition, not stable
+///
+/// Searches the next match with SIMD, so it is faster than std::partition
+/// when few elements match and slower when many do.
+template <typename T, unsigned Nbits, typename A>
+tagged_ptr<T, Nbits, A> *
+partition_bits(tagged_ptr<T, Nbits, A> *first, tagged_ptr<T, Nbits, A> *last,
+               typename tagged_ptr<T, Nbits, A>::bits_type mask,
+               typename tagged_ptr<T, Nbits, A>::bits_type value) {
+  // elements between first and the next match do not match
+  first = find_bits(first, last, mask, value, false);
+  if (first == last)
+    return first;
+  auto next = first;
+  while ((next = find_bits(next + 1, last, mask, value)) != last) {
+    first->swap(*next);
+    ++first;
+  }
+  return first;
+}
+
+/// copy raw pointers of elements with (bits() & mask) == value to out, which
+/// must have room for last - first pointers; return end of written range
+template <typename T, unsigned Nbits, typename A>
+typename tagged_ptr<T, Nbits, A>::pointer *
+gather_bits(const tagged_ptr<T, Nbits, A> *first,
+            const tagged_ptr<T, Nbits, A> *last,
+            typename tagged_ptr<T, Nbits, A>::bits_type mask,
+            typename tagged_ptr<T, Nbits, A>::bits_type value,
+            typename tagged_ptr<T, Nbits, A>::pointer *out) {
+  using namespace detail::simd;
+  static_assert(sizeof(*out) == sizeof(word), "unexpected pointer size");
+  const auto ptr_mask = detail::make_ptr_mask(Nbits);
+  mask &= ~ptr_mask;
+  const auto p = detail::words(first);
+  const std::size_t n = last - first;
+  const auto o = reinterpret_cast<word *>(out);
+  switch (best()) {
+  case isa::avx512:
+    return out + avx512::gather(p, n, mask, value, ptr_mask, o);
+  case isa::avx2:
+    return out + avx2::gather(p, n, mask, value, ptr_mask, o);
+  default:
+    return out + scalar::gather(p, n, mask, value, ptr_mask, o);
+  }
+}
+
+/// set the tag bits in mask for all elements in [first, last)
+template <typename T, unsigned Nbits, typename A>
+void set_bits(tagged_ptr<T, Nbits, A> *first, tagged_ptr<T, Nbits, A> *last,
+              typename tagged_ptr<T, Nbits, A>::bits_type mask) {
+  using namespace detail::simd;
+  mask &= ~detail::make_ptr_mask(Nbits);
+  const auto p = detail::words(first);
+  const std::size_t n = last - first;
+  switch (best()) {
+  case isa::avx512:
+    return avx512::set(p, n, mask);
+  case isa::avx2:
+    return avx2::set(p, n, mask);
+  default:
+    return scalar::set(p, n, mask);
+  }
+}
+
+/// clear the tag bits in mask for all elements in [first, last)
+template <typename T, unsigned Nbits, typename A>
+void clear_bits(tagged_ptr<T, Nbits, A> *first, tagged_ptr<T, Nbits, A> *last,
+                typename tagged_ptr<T, Nbits, A>::bits_type mask) {
+  using namespace detail::simd;
+  mask &= ~detail::make_ptr_mask(Nbits);
+  const auto p = detail::words(first);
+  const std::size_t n = last - first;
+  switch (best()) {
+  case isa::avx512:
+    return avx512::clear(p, n, mask);
+  case isa::avx2:
+    return avx2::clear(p, n, mask);
+  default:
+    return scalar::clear(p, n, mask);
+  }
+}
+
+} // namespace stateful_pointer
+
+#endif
@@ -6,6 +6,8 @@
 #include "boost/assert.hpp"
 #include "boost/cstdint.hpp"
 #include "boost/type_traits.hpp"
+#include "boost/utility/enable_if.hpp"
+#include "stateful_pointer/stats.hpp"
 #include <cstddef>
 
 namespace stateful_pointer {
@@ -20,16 +22,39 @@ constexpr unsigned pow2(unsigned n) noexcept {
 constexpr ::boost::uintptr_t make_ptr_mask(unsigned n) noexcept {
   return ~::boost::uintptr_t(0) << n;
 }
-template <typename T, unsigned N> struct make_dispatch;
+/// alignment of memory that holds elements of type T with Nbits of tag
+template <typename T, unsigned Nbits>
+constexpr std::size_t alloc_alignment() noexcept {
+  return max(pow2(Nbits), ::boost::alignment::alignment_of<T>::value);
+}
+template <typename T, unsigned N, typename A> struct make_dispatch;
 } // namespace detail
 
-template <typename T, unsigned Nbits> class tagged_ptr {
+/// default allocation policy, uses aligned memory from Boost.Align
+///
+/// An allocation policy is a stateless type with two static member functions,
+/// `void* allocate(std::size_t alignment, std::size_t size)` and
+/// `void deallocate(void* p)`. The policy is part of the tagged_ptr type, so
+/// that the pointer stays as small as a raw pointer.
+struct default_allocator {
+  static void *allocate(std::size_t alignment, std::size_t size) {
+    return ::boost::alignment::aligned_alloc(alignment, size);
+  }
+
+  static void deallocate(void *p) noexcept {
+    ::boost::alignment::aligned_free(p);
+  }
+};
+
+template <typename T, unsigned Nbits, typename Allocator = default_allocator>
+class tagged_ptr {
 public:
   using bits_type = ::boost::uintptr_t;
   using pos_type = std::size_t; // only for array version
   using element_type = typename ::boost::remove_extent<T>::type;
   using pointer = element_type *;
   using reference = element_type &;
+  using allocator_type = Allocator;
 
   constexpr tagged_ptr() noexcept : value(0) {}
 
@@ -53,7 +78,9 @@ public:
   template <typename U, typename = typename ::boost::enable_if_c<
                             !(::boost::is_array<U>::value) &&
                             ::boost::is_convertible<U *, T *>::value>::type>
-  tagged_ptr(tagged_ptr<U, Nbits> &&other) noexcept : value(other.value) {
+  tagged_ptr(tagged_ptr<U, Nbits, Allocator> &&other) noexcept
+      : value(other.value) {
+    detail::stats_convert<U, Nbits>(detail::alloc_alignment<U, Nbits>());
     other.value = 0;
   }
 
@@ -61,11 +88,11 @@ public:
   template <typename U, typename = typename ::boost::enable_if_c<
                             !(::boost::is_array<U>::value) &&
                             ::boost::is_convertible<U *, T *>::value>::type>
-  tagged_ptr &operator=(tagged_ptr<U, Nbits> &&other) noexcept {
-    if (this != &other) {
-      value = other.value;
-      other.value = 0;
-    }
+  tagged_ptr &operator=(tagged_ptr<U, Nbits, Allocator> &&other) noexcept {
+    // other has a different type, so it cannot be *this
+    detail::stats_convert<U, Nbits>(detail::alloc_alignment<U, Nbits>());
+    value = other.value;
+    other.value = 0;
     return *this;
   }
 
@@ -166,9 +193,13 @@ private:
 
   template <typename U> struct delete_dispatch {
     static void doit(pointer p) {
+      // before the destructor, which ends the dynamic type of *p
+      detail::stats_deallocate_object<T, Nbits>(
+          p, detail::alloc_alignment<element_type, Nbits>(),
+          sizeof(element_type));
       // automatically skipped if T has trivial destructor
       p->~element_type();
-      ::boost::alignment::aligned_free(p);
+      Allocator::deallocate(p);
     }
   };
 
@@ -176,12 +207,15 @@ private:
     static void doit(pointer iter) {
       auto end_p = array_end_p(iter);
       auto p = reinterpret_cast<pointer>(end_p);
+      auto end = *end_p;
+      detail::stats_deallocate<T, Nbits>(
+          detail::alloc_alignment<element_type, Nbits>(),
+          sizeof(pointer) + (end - iter) * sizeof(element_type));
       if (!::boost::has_trivial_destructor<element_type>::value) {
-        auto end = *end_p;
         while (iter != end)
           (iter++)->~element_type();
       }
-      ::boost::alignment::aligned_free(p);
+      Allocator::deallocate(p);
     }
   };
 
@@ -192,7 +226,10 @@ private:
         for (decltype(N) i = 0; i < N; ++i)
           (iter++)->~element_type();
       }
-      ::boost::alignment::aligned_free(p);
+      detail::stats_deallocate<T, Nbits>(
+          detail::alloc_alignment<element_type, Nbits>(),
+          N * sizeof(element_type));
+      Allocator::deallocate(p);
     }
   };
 
@@ -222,37 +259,36 @@ private:
 
   friend void swap(tagged_ptr &a, tagged_ptr &b) noexcept { a.swap(b); }
 
-  template <typename U, unsigned M> friend class tagged_ptr;
+  template <typename U, unsigned M, typename A> friend class tagged_ptr;
 
-  template <typename U, unsigned M> friend struct detail::make_dispatch;
+  template <typename U, unsigned M, typename A>
+  friend struct detail::make_dispatch;
 
   bits_type value;
 };
 
 namespace detail {
-template <typename T, unsigned Nbits> struct make_dispatch {
+template <typename T, unsigned Nbits, typename Allocator> struct make_dispatch {
   template <typename... Args>
-  static tagged_ptr<T, Nbits> doit(Args &&... args) {
-    tagged_ptr<T, Nbits> p;
-    auto address = ::boost::alignment::aligned_alloc(
-        detail::max(detail::pow2(Nbits),
-                    ::boost::alignment::alignment_of<T>::value),
-        sizeof(T));
+  static tagged_ptr<T, Nbits, Allocator> doit(Args &&... args) {
+    tagged_ptr<T, Nbits, Allocator> p;
+    constexpr auto alignment = detail::alloc_alignment<T, Nbits>();
+    auto address = Allocator::allocate(alignment, sizeof(T));
+    detail::stats_allocate<T, Nbits>(alignment, sizeof(T));
     p.value = reinterpret_cast<decltype(p.value)>(address);
     new (address) T(std::forward<Args>(args)...);
     return p;
   }
 };
 
-template <typename T, unsigned Nbits, std::size_t N>
-struct make_dispatch<T[N], Nbits> {
+template <typename T, unsigned Nbits, typename Allocator, std::size_t N>
+struct make_dispatch<T[N], Nbits, Allocator> {
   template <typename... Args>
-  static tagged_ptr<T[N], Nbits> doit(Args &&... args) {
-    tagged_ptr<T[N], Nbits> p;
-    auto address = ::boost::alignment::aligned_alloc(
-        detail::max(detail::pow2(Nbits),
-                    ::boost::alignment::alignment_of<T>::value),
-        N * sizeof(T));
+  static tagged_ptr<T[N], Nbits, Allocator> doit(Args &&... args) {
+    tagged_ptr<T[N], Nbits, Allocator> p;
+    constexpr auto alignment = detail::alloc_alignment<T, Nbits>();
+    auto address = Allocator::allocate(alignment, N * sizeof(T));
+    detail::stats_allocate<T[N], Nbits>(alignment, N * sizeof(T));
     p.value = reinterpret_cast<decltype(p.value)>(address);
     auto iter = reinterpret_cast<T *>(address);
     for (decltype(N) i = 0; i < N; ++i) {
@@ -262,14 +298,17 @@ struct make_dispatch<T[N], Nbits> {
   }
 };
 
-template <typename T, unsigned Nbits> struct make_dispatch<T[], Nbits> {
+template <typename T, unsigned Nbits, typename Allocator>
+struct make_dispatch<T[], Nbits, Allocator> {
   template <typename... Args>
-  static tagged_ptr<T[], Nbits> doit(std::size_t size, Args &&... args) {
-    tagged_ptr<T[], Nbits> p;
-    auto address = reinterpret_cast<char *>(::boost::alignment::aligned_alloc(
-        detail::max(detail::pow2(Nbits),
-                    ::boost::alignment::alignment_of<T>::value),
-        sizeof(T *) + size * sizeof(T)));
+  static tagged_ptr<T[], Nbits, Allocator> doit(std::size_t size,
+                                                Args &&... args) {
+    tagged_ptr<T[], Nbits, Allocator> p;
+    constexpr auto alignment = detail::alloc_alignment<T, Nbits>();
+    const auto bytes = sizeof(T *) + size * sizeof(T);
+    auto address =
+        reinterpret_cast<char *>(Allocator::allocate(alignment, bytes));
+    detail::stats_allocate<T[], Nbits>(alignment, bytes);
     auto iter = reinterpret_cast<T *>(address + sizeof(T *));
     const auto end = iter + size;
     *reinterpret_cast<T **>(address) = end;
@@ -281,9 +320,11 @@ template <typename T, unsigned Nbits> struct make_dispatch<T[], Nbits> {
 };
 } // namespace detail
 
-template <typename T, unsigned Nbits, class... Args>
-tagged_ptr<T, Nbits> make_tagged(Args &&... args) {
-  return detail::make_dispatch<T, Nbits>::doit(std::forward<Args>(args)...);
+template <typename T, unsigned Nbits, typename Allocator = default_allocator,
+          class... Args>
+tagged_ptr<T, Nbits, Allocator> make_tagged(Args &&... args) {
+  return detail::make_dispatch<T, Nbits, Allocator>::doit(
+      std::forward<Args>(args)...);
 }
 
 } // namespace stateful_pointer
@@ -0,0 +1,77 @@
+#include "benchmark/benchmark.h"
+#include "cstdlib"
+#include "stateful_pointer/charconv.hpp"
+#include "string"
+
+namespace sp = stateful_pointer;
+
+// the integer has state.range(0) digits
+template <typename T> static T number(benchmark::State &state) {
+  T v = 1;
+  for (int i = 1; i < state.range(0); ++i)
+    v *= 10;
+  return v + 1;
+}
+
+static void std_to_string_copy_int(benchmark::State &state) {
+  auto v = number<long long>(state);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(v);
+    const auto s = std::to_string(v);
+    benchmark::DoNotOptimize(sp::string(s.data(), s.size()));
+  }
+}
+
+static void sp_to_string_int(benchmark::State &state) {
+  auto v = number<long long>(state);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(v);
+    benchmark::DoNotOptimize(sp::to_string(v));
+  }
+}
+
+// std::to_string formats doubles with %f, so compare with %g via snprintf
+static void std_snprintf_copy_double(benchmark::State &state) {
+  double v = 0.1;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(v);
+    char buf[32];
+    const auto n = std::snprintf(buf, sizeof(buf), "%.17g", v);
+    benchmark::DoNotOptimize(sp::string(buf, n));
+  }
+}
+
+static void sp_to_string_double(benchmark::State &state) {
+  double v = 0.1;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(v);
+    benchmark::DoNotOptimize(sp::to_string(v));
+  }
+}
+
+static void std_strtoll(benchmark::State &state) {
+  const auto s = sp::to_string(number<long long>(state));
+  while (state.KeepRunning()) {
+    // needs a null-terminated copy, sp::string does not store one in SSO mode
+    const std::string tmp(s.begin(), s.end());
+    benchmark::DoNotOptimize(std::strtoll(tmp.c_str(), nullptr, 10));
+  }
+}
+
+static void sp_from_chars_int(benchmark::State &state) {
+  const auto s = sp::to_string(number<long long>(state));
+  while (state.KeepRunning()) {
+    long long v = 0;
+    benchmark::DoNotOptimize(sp::from_chars(s, v));
+    benchmark::DoNotOptimize(v);
+  }
+}
+
+BENCHMARK(std_to_string_copy_int)->Arg(1)->Arg(4)->Arg(7)->Arg(12)->Arg(18);
+BENCHMARK(sp_to_string_int)->Arg(1)->Arg(4)->Arg(7)->Arg(12)->Arg(18);
+BENCHMARK(std_snprintf_copy_double);
+BENCHMARK(sp_to_string_double);
+BENCHMARK(std_strtoll)->Arg(1)->Arg(7)->Arg(18);
+BENCHMARK(sp_from_chars_int)->Arg(1)->Arg(7)->Arg(18);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include "benchmark/benchmark.h"
+#include "memory"
+#include "stateful_pointer/gc_arena.hpp"
+#include "vector"
+
+namespace sp = stateful_pointer;
+
+struct gc_node {
+  int a = 0;
+  sp::gc_ptr<gc_node> left, right;
+};
+
+namespace stateful_pointer {
+template <> struct gc_traits<gc_node> {
+  template <typename F> static void for_each_child(gc_node &n, F &&f) {
+    f(n.left);
+    f(n.right);
+  }
+};
+} // namespace stateful_pointer
+
+struct shared_node {
+  int a = 0;
+  std::shared_ptr<shared_node> left, right;
+};
+
+// complete binary tree with n nodes, node i has children 2i+1 and 2i+2
+static sp::gc_ptr<gc_node> make_gc_tree(sp::gc_arena<gc_node> &arena,
+                                        std::size_t n) {
+  std::vector<sp::gc_ptr<gc_node>> v;
+  for (std::size_t i = 0; i < n; ++i)
+    v.push_back(arena.make());
+  for (std::size_t i = 0; 2 * i + 1 < n; ++i) {
+    v[i]->left = v[2 * i + 1];
+    if (2 * i + 2 < n)
+      v[i]->right = v[2 * i + 2];
+  }
+  return v[0];
+}
+
+static std::shared_ptr<shared_node> make_shared_tree(std::size_t n) {
+  std::vector<std::shared_ptr<shared_node>> v;
+  for (std::size_t i = 0; i < n; ++i)
+    v.push_back(std::make_shared<shared_node>());
+  for (std::size_t i = 0; 2 * i + 1 < n; ++i) {
+    v[i]->left = v[2 * i + 1];
+    if (2 * i + 2 < n)
+      v[i]->right = v[2 * i + 2];
+  }
+  return v[0];
+}
+
+// pause to release a whole tree by dropping the last reference to its root
+static void shared_ptr_release(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    auto root = make_shared_tree(state.range(0));
+    state.ResumeTiming();
+    root.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// pause to collect a whole tree which is no longer reachable
+static void gc_collect_garbage(benchmark::State &state) {
+  sp::gc_arena<gc_node> arena;
+  std::vector<sp::gc_ptr<gc_node>> roots;
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    make_gc_tree(arena, state.range(0));
+    state.ResumeTiming();
+    arena.collect(roots.begin(), roots.end(), state.range(1));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// pause to mark a tree which stays alive
+static void gc_collect_live(benchmark::State &state) {
+  sp::gc_arena<gc_node> arena;
+  std::vector<sp::gc_ptr<gc_node>> roots = {
+      make_gc_tree(arena, state.range(0))};
+  while (state.KeepRunning()) {
+    arena.collect(roots.begin(), roots.end(), state.range(1));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(shared_ptr_release)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(gc_collect_garbage)
+    ->Args({1 << 20, 1})
+    ->Args({1 << 20, 4})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(gc_collect_live)
+    ->Args({1 << 20, 1})
+    ->Args({1 << 20, 4})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
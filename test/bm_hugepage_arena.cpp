@@ -0,0 +1,51 @@
+#include "algorithm"
+#include "benchmark/benchmark.h"
+#include "numeric"
+#include "random"
+#include "stateful_pointer/hugepage_arena.hpp"
+#include "stateful_pointer/tagged_ptr.hpp"
+#include "vector"
+
+namespace sp = stateful_pointer;
+
+struct node {
+  node *next = nullptr;
+  std::size_t value = 0;
+};
+
+// builds a single cycle through all nodes in random order and follows it
+template <typename Allocator>
+static void random_traversal(benchmark::State &state) {
+  const std::size_t n = state.range(0);
+  std::vector<sp::tagged_ptr<node, 4, Allocator>> nodes;
+  nodes.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    nodes.push_back(sp::make_tagged<node, 4, Allocator>());
+    nodes.back()->value = i;
+  }
+  std::vector<std::size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(1));
+  for (std::size_t i = 0; i < n; ++i)
+    nodes[order[i]]->next = nodes[order[(i + 1) % n]].get();
+
+  while (state.KeepRunning()) {
+    std::size_t sum = 0;
+    auto p = nodes[order[0]].get();
+    for (std::size_t i = 0; i < n; ++i) {
+      sum += p->value;
+      p = p->next;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK_TEMPLATE(random_traversal, sp::default_allocator)
+    ->Arg(10000000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(random_traversal, sp::hugepage_allocator<>)
+    ->Arg(10000000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,10 +1,21 @@
 #!/usr/bin/env python
+"""
+Convert Google benchmark JSON output from stdin to a markdown table.
+
+With --baseline, the CPU time of each benchmark is compared to an earlier
+run. Benchmarks which got slower by more than --threshold percent are marked
+and the script exits with status 1, so that it can gate upgrades.
+"""
+from __future__ import print_function
 import argparse
 import json
 import sys
 
 parser = argparse.ArgumentParser()
 parser.add_argument("header", nargs="+")
+parser.add_argument("--baseline", help="JSON output of an earlier run")
+parser.add_argument("--threshold", type=float, default=5.0,
+                    help="allowed slow-down in percent (default: 5)")
 
 bm = json.load(sys.stdin)
 
@@ -19,7 +30,6 @@ for d in bm["benchmarks"]:
 columns.append(names)
 
 for arg in args.header:
-    print arg
     if arg == "c":
         col = ["CPU [%s]" % bm["benchmarks"][0]["time_unit"]]
         for d in bm["benchmarks"]:
@@ -34,6 +44,28 @@ for arg in args.header:
             col.append("%i" % d["iterations"])
     columns.append(col)
 
+regressions = []
+if args.baseline:
+    with open(args.baseline) as f:
+        base = dict((d["name"], d) for d in json.load(f)["benchmarks"])
+    # compare in nanoseconds, runs may use different time units
+    scale = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+    col = ["CPU change"]
+    for d in bm["benchmarks"]:
+        b = base.get(d["name"])
+        if b is None or b["cpu_time"] == 0:
+            col.append("new")
+            continue
+        new = d["cpu_time"] * scale[d["time_unit"]]
+        old = b["cpu_time"] * scale[b["time_unit"]]
+        change = 100.0 * (new - old) / old
+        cell = "%+.1f%%" % change
+        if change > args.threshold:
+            cell += " (!)"
+            regressions.append((d["name"], change))
+        col.append(cell)
+    columns.append(col)
+
 widths = [max([len(x) for x in col]) for col in columns]
 
 for i,n in enumerate(names):
@@ -45,3 +77,8 @@ for irow in range(len(names)):
     if irow == 0:
         line = "|:" + "-"*(widths[0]-1) + "|" + ":|".join(["-"*(w-1) for w in widths[1:]]) + ":|"
         sys.stdout.write(line + "\n")
+
+if regressions:
+    for name, change in regressions:
+        print("regression: %s %+.1f%%" % (name, change), file=sys.stderr)
+    sys.exit(1)
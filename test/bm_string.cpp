@@ -0,0 +1,226 @@
+#include "algorithm"
+#include "benchmark/benchmark.h"
+#include "boost/align/aligned_alloc.hpp"
+#include "boost/functional/hash.hpp"
+#include "cstdlib"
+#include "new"
+#include "random"
+#include "sstream"
+#include "string"
+#include "unordered_map"
+#include "vector"
+
+// count heap bytes of both string types, see test_string.cpp
+static std::size_t heap_bytes = 0, heap_allocs = 0;
+namespace boost {
+namespace alignment {
+void *custom_aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+  heap_bytes += size;
+  ++heap_allocs;
+  return aligned_alloc(alignment, size);
+}
+} // namespace alignment
+} // namespace boost
+#define aligned_alloc(alignment, size) custom_aligned_alloc(alignment, size)
+#include "stateful_pointer/string.hpp"
+
+void *operator new(std::size_t size) {
+  heap_bytes += size;
+  ++heap_allocs;
+  if (auto p = std::malloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+// the replaced operator new allocates with malloc, so free is the matching
+// release; GCC cannot see that through the replacement and warns
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace sp = stateful_pointer;
+
+// small string optimisation ends at 7 for sp::string and 15 for libstdc++
+static void lengths(benchmark::internal::Benchmark *b) {
+  for (auto n : {0, 1, 4, 7, 8, 15, 16, 32, 64})
+    b->Arg(n);
+}
+
+static std::vector<std::string> random_strings(std::size_t n,
+                                               std::size_t length) {
+  static const char chars[] = "0123456789abcdefghijklmnopqrstuvwxyz"
+                              "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<std::size_t> dis(0, sizeof(chars) - 2);
+  std::vector<std::string> result(n);
+  for (auto &s : result)
+    for (std::size_t i = 0; i < length; ++i)
+      s.push_back(chars[dis(gen)]);
+  return result;
+}
+
+template <typename String> static String make(const std::string &s) {
+  return String(s.data(), s.size());
+}
+
+struct range_hash {
+  template <typename String> std::size_t operator()(const String &s) const {
+    return ::boost::hash_range(s.begin(), s.end());
+  }
+};
+
+template <typename String> static void construction(benchmark::State &state) {
+  const std::string src(state.range(0), 'a');
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(make<String>(src));
+  }
+}
+
+template <typename String> static void comparison(benchmark::State &state) {
+  const std::string src(state.range(0), 'a');
+  const auto a = make<String>(src);
+  const auto b = make<String>(src);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(a == b);
+  }
+}
+
+template <typename String> static void iteration(benchmark::State &state) {
+  const auto s = make<String>(std::string(state.range(0), 'a'));
+  while (state.KeepRunning()) {
+    int sum = 0;
+    for (auto ch : s)
+      sum += ch;
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+template <typename String> static void streaming(benchmark::State &state) {
+  const auto s = make<String>(std::string(state.range(0), 'a'));
+  std::ostringstream os;
+  while (state.KeepRunning()) {
+    os.seekp(0);
+    os << s;
+  }
+}
+
+// fill a vector and report bytes per element, including heap memory
+template <typename String> static void memory(benchmark::State &state) {
+  const std::size_t n = 1000;
+  const std::string src(state.range(0), 'a');
+  std::size_t bytes = 0;
+  while (state.KeepRunning()) {
+    std::vector<String> v;
+    v.reserve(n);
+    heap_bytes = 0;
+    for (std::size_t i = 0; i < n; ++i)
+      v.push_back(make<String>(src));
+    bytes = heap_bytes;
+  }
+  state.counters["bytes_per_element"] =
+      sizeof(String) + static_cast<double>(bytes) / n;
+}
+
+template <typename String> static void sort(benchmark::State &state) {
+  const auto src = random_strings(10000, state.range(0));
+  std::vector<String> v;
+  v.reserve(src.size());
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    v.clear();
+    for (const auto &s : src)
+      v.push_back(make<String>(s));
+    state.ResumeTiming();
+    std::sort(v.begin(), v.end());
+  }
+  state.SetItemsProcessed(state.iterations() * src.size());
+}
+
+template <typename String>
+static void unordered_map_lookup(benchmark::State &state) {
+  const auto src = random_strings(10000, state.range(0));
+  std::unordered_map<String, int, range_hash> map;
+  std::vector<String> keys;
+  for (const auto &s : src) {
+    map.emplace(make<String>(s), 0);
+    keys.push_back(make<String>(s));
+  }
+  while (state.KeepRunning()) {
+    for (const auto &k : keys)
+      benchmark::DoNotOptimize(map.find(k));
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// identifiers from source code and UI text, all in the basic multilingual
+// plane, weighted by how often such names occur
+static std::vector<std::u32string> identifiers() {
+  static const char32_t *const words[] = {
+      U"i",      U"j",       U"n",        U"x",        U"id",
+      U"it",     U"os",      U"pos",      U"key",      U"len",
+      U"buf",    U"size",    U"data",     U"name",     U"node",
+      U"next",   U"args",    U"self",     U"value",    U"count",
+      U"first",  U"index",   U"result",   U"buffer",   U"offset",
+      U"length", U"element", U"capacity", U"iterator", U"push_back",
+      U"Größe",  U"Wert",    U"名前",     U"変数",     U"データ",
+      U"größe",  U"ключ",    U"имя",      U"λ",        U"Δt"};
+  const std::size_t n = sizeof(words) / sizeof(*words);
+  std::vector<std::u32string> result;
+  for (std::size_t i = 0; i < 1000; ++i)
+    result.emplace_back(words[i * 7 % n]);
+  return result;
+}
+
+// construct the corpus and report heap allocations per string
+template <typename String>
+static void identifier_corpus(benchmark::State &state) {
+  using char_type = typename String::value_type;
+  std::vector<std::basic_string<char_type>> src;
+  for (const auto &w : identifiers())
+    src.emplace_back(w.begin(), w.end()); // narrowing is exact in the BMP
+  std::size_t allocs = 0, bytes = 0;
+  while (state.KeepRunning()) {
+    std::vector<String> v;
+    v.reserve(src.size());
+    heap_allocs = heap_bytes = 0;
+    for (const auto &s : src)
+      v.push_back(String(s.begin(), s.end()));
+    allocs = heap_allocs;
+    bytes = heap_bytes;
+  }
+  state.counters["allocs_per_string"] =
+      static_cast<double>(allocs) / src.size();
+  state.counters["bytes_per_element"] =
+      sizeof(String) + static_cast<double>(bytes) / src.size();
+}
+
+BENCHMARK_TEMPLATE(construction, std::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(construction, sp::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(comparison, std::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(comparison, sp::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(iteration, std::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(iteration, sp::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(streaming, std::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(streaming, sp::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(memory, std::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(memory, sp::string)->Apply(lengths);
+BENCHMARK_TEMPLATE(sort, std::string)->Arg(4)->Arg(7)->Arg(32);
+BENCHMARK_TEMPLATE(sort, sp::string)->Arg(4)->Arg(7)->Arg(32);
+BENCHMARK_TEMPLATE(unordered_map_lookup, std::string)->Arg(4)->Arg(7)->Arg(32);
+BENCHMARK_TEMPLATE(unordered_map_lookup, sp::string)->Arg(4)->Arg(7)->Arg(32);
+
+BENCHMARK_TEMPLATE(identifier_corpus, std::u16string);
+BENCHMARK_TEMPLATE(identifier_corpus, sp::basic_string<char16_t>);
+BENCHMARK_TEMPLATE(identifier_corpus, sp::u16string);
+BENCHMARK_TEMPLATE(identifier_corpus, std::u32string);
+BENCHMARK_TEMPLATE(identifier_corpus, sp::basic_string<char32_t>);
+BENCHMARK_TEMPLATE(identifier_corpus, sp::u32string);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include "benchmark/benchmark.h"
+#include "cstdio"
+#include "fstream"
+#include "map"
+#include "stateful_pointer/charconv.hpp"
+#include "stateful_pointer/string_table.hpp"
+#include "string"
+#include "tuple"
+#include "vector"
+
+namespace sp = stateful_pointer;
+
+// n identifiers of 1 to 16 characters, about half of them fit into SSO, both
+// as a text file with one string per line and as a string table
+struct corpus {
+  explicit corpus(std::size_t n)
+      : text("bm_string_table_" + std::to_string(n) + ".txt"),
+        table("bm_string_table_" + std::to_string(n) + ".bin") {
+    std::vector<sp::string> v;
+    v.reserve(n);
+    std::ofstream os(text, std::ios::binary);
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto id = sp::to_string(i * 2654435761u % 100000000u);
+      const auto len = 1 + i % 16;
+      std::string s = i % 3 ? "id_" : "name_";
+      s.append(id.begin(), id.end());
+      s.resize(len, '_');
+      os << s << '\n';
+      v.emplace_back(s.begin(), s.end());
+    }
+    std::ofstream ts(table, std::ios::binary);
+    sp::write_string_table(ts, v.begin(), v.end());
+  }
+
+  ~corpus() {
+    std::remove(text.c_str());
+    std::remove(table.c_str());
+  }
+
+  static const corpus &get(std::size_t n) {
+    static std::map<std::size_t, corpus> cache;
+    auto it = cache.find(n);
+    if (it == cache.end())
+      it = cache.emplace(std::piecewise_construct, std::forward_as_tuple(n),
+                         std::forward_as_tuple(n))
+               .first;
+    return it->second;
+  }
+
+  const std::string text, table;
+};
+
+template <typename String>
+static void getline_vector(benchmark::State &state) {
+  const auto &c = corpus::get(state.range(0));
+  while (state.KeepRunning()) {
+    std::ifstream is(c.text, std::ios::binary);
+    std::vector<String> v;
+    std::string line;
+    while (std::getline(is, line))
+      v.emplace_back(line.begin(), line.end());
+    benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void string_table_load(benchmark::State &state) {
+  const auto &c = corpus::get(state.range(0));
+  while (state.KeepRunning()) {
+    const sp::string_table t(c.table.c_str());
+    benchmark::DoNotOptimize(t.begin());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// load and touch every string once, so that all pages are mapped
+static void string_table_load_scan(benchmark::State &state) {
+  const auto &c = corpus::get(state.range(0));
+  while (state.KeepRunning()) {
+    const sp::string_table t(c.table.c_str());
+    std::size_t n = 0;
+    for (const auto &s : t)
+      n += s.size() + s[0];
+    benchmark::DoNotOptimize(n);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void sizes(benchmark::internal::Benchmark *b) {
+  b->Arg(1 << 20)->Arg(50000000)->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(getline_vector, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(getline_vector, sp::string)->Apply(sizes);
+BENCHMARK(string_table_load)->Apply(sizes);
+BENCHMARK(string_table_load_scan)->Apply(sizes);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,162 @@
+#include "algorithm"
+#include "benchmark/benchmark.h"
+#include "random"
+#include "stateful_pointer/tag_algorithm.hpp"
+#include "vector"
+
+namespace sp = stateful_pointer;
+
+using ptr_t = sp::tagged_ptr<int, 4>;
+
+// null pointers with random tags, so that 1e8 elements fit into memory
+static std::vector<ptr_t> make_pointers(std::size_t n) {
+  std::vector<ptr_t> v(n);
+  std::mt19937 gen(1);
+  for (auto &p : v)
+    p.bits(gen());
+  return v;
+}
+
+static void scalar_count(benchmark::State &state) {
+  const auto v = make_pointers(state.range(0));
+  while (state.KeepRunning()) {
+    std::size_t c = 0;
+    for (const auto &p : v)
+      c += p.bit(0) && p.bit(2);
+    benchmark::DoNotOptimize(c);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void bulk_count(benchmark::State &state) {
+  const auto v = make_pointers(state.range(0));
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(
+        sp::count_bits(v.data(), v.data() + v.size(), 5, 5));
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void scalar_find(benchmark::State &state) {
+  auto v = make_pointers(state.range(0));
+  sp::clear_bits(v.data(), v.data() + v.size(), 8);
+  v.back().bit(3, true);
+  while (state.KeepRunning()) {
+    auto it = v.begin();
+    while (it != v.end() && !it->bit(3))
+      ++it;
+    benchmark::DoNotOptimize(it);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void bulk_find(benchmark::State &state) {
+  auto v = make_pointers(state.range(0));
+  sp::clear_bits(v.data(), v.data() + v.size(), 8);
+  v.back().bit(3, true);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(
+        sp::find_bits(v.data(), v.data() + v.size(), 8, 8));
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void scalar_gather(benchmark::State &state) {
+  const auto v = make_pointers(state.range(0));
+  std::vector<int *> out(v.size());
+  while (state.KeepRunning()) {
+    auto o = out.data();
+    for (const auto &p : v)
+      if (p.bit(1) && !p.bit(3))
+        *o++ = p.get();
+    benchmark::DoNotOptimize(o);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void bulk_gather(benchmark::State &state) {
+  const auto v = make_pointers(state.range(0));
+  std::vector<int *> out(v.size());
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(
+        sp::gather_bits(v.data(), v.data() + v.size(), 10, 2, out.data()));
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void scalar_set(benchmark::State &state) {
+  auto v = make_pointers(state.range(0));
+  while (state.KeepRunning()) {
+    for (auto &p : v)
+      p.bit(2, true);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void bulk_set(benchmark::State &state) {
+  auto v = make_pointers(state.range(0));
+  while (state.KeepRunning()) {
+    sp::set_bits(v.data(), v.data() + v.size(), 4);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+// tags where bit 3 is set for state.range(1) percent of the elements
+static std::vector<ptr_t::bits_type> partition_tags(benchmark::State &state) {
+  std::vector<ptr_t::bits_type> tags(state.range(0));
+  std::mt19937 gen(2);
+  std::uniform_int_distribution<int> percent(0, 99);
+  for (auto &t : tags)
+    t = (gen() & 7) | (percent(gen) < state.range(1) ? 8 : 0);
+  return tags;
+}
+
+static void scalar_partition(benchmark::State &state) {
+  const auto tags = partition_tags(state);
+  std::vector<ptr_t> v(tags.size());
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    for (std::size_t i = 0; i < v.size(); ++i)
+      v[i].bits(tags[i]);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(std::partition(
+        v.begin(), v.end(), [](const ptr_t &p) { return p.bit(3); }));
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+static void bulk_partition(benchmark::State &state) {
+  const auto tags = partition_tags(state);
+  std::vector<ptr_t> v(tags.size());
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    for (std::size_t i = 0; i < v.size(); ++i)
+      v[i].bits(tags[i]);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(
+        sp::partition_bits(v.data(), v.data() + v.size(), 8, 8));
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+// sizes, and percentage of matches for the partition benchmarks
+static void partition_args(benchmark::internal::Benchmark *b) {
+  for (auto n : {1 << 16, 100000000})
+    for (auto d : {1, 10, 50, 90})
+      b->Args({n, d});
+}
+
+BENCHMARK(scalar_count)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(bulk_count)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(scalar_find)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(bulk_find)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(scalar_gather)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(bulk_gather)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(scalar_set)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(bulk_set)->Arg(1 << 16)->Arg(100000000);
+BENCHMARK(scalar_partition)->Apply(partition_args);
+BENCHMARK(bulk_partition)->Apply(partition_args);
+
+BENCHMARK_MAIN();
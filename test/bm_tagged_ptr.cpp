@@ -2,6 +2,7 @@
 #include "benchmark/benchmark.h"
 #include "memory"
 #include "stateful_pointer/tagged_ptr.hpp"
+#include "vector"
 
 namespace sp = stateful_pointer;
 
@@ -31,6 +32,34 @@ template <typename T> static void tagged_ptr_access(benchmark::State &state) {
   }
 }
 
+template <typename T>
+static void unique_ptr_traversal(benchmark::State &state) {
+  std::vector<std::unique_ptr<T>> v;
+  for (int i = 0; i < state.range(0); ++i)
+    v.emplace_back(new T(i));
+  while (state.KeepRunning()) {
+    T sum = 0;
+    for (const auto &p : v)
+      sum += *p;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+template <typename T>
+static void tagged_ptr_traversal(benchmark::State &state) {
+  std::vector<sp::tagged_ptr<T, 4>> v;
+  for (int i = 0; i < state.range(0); ++i)
+    v.push_back(sp::make_tagged<T, 4>(i));
+  while (state.KeepRunning()) {
+    T sum = 0;
+    for (const auto &p : v)
+      sum += *p;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
 BENCHMARK_TEMPLATE(unique_ptr_creation, char);
 BENCHMARK_TEMPLATE(tagged_ptr_creation, char);
 BENCHMARK_TEMPLATE(unique_ptr_creation, std::array<char, 256>);
@@ -39,5 +68,7 @@ BENCHMARK_TEMPLATE(unique_ptr_access, char);
 BENCHMARK_TEMPLATE(tagged_ptr_access, char);
 BENCHMARK_TEMPLATE(unique_ptr_access, std::array<char, 256>);
 BENCHMARK_TEMPLATE(tagged_ptr_access, std::array<char, 256>);
+BENCHMARK_TEMPLATE(unique_ptr_traversal, int)->Arg(1 << 10)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(tagged_ptr_traversal, int)->Arg(1 << 10)->Arg(1 << 20);
 
 BENCHMARK_MAIN();
@@ -0,0 +1,181 @@
+#include "boost/align/aligned_alloc.hpp"
+#include "boost/core/lightweight_test.hpp"
+#include "clocale"
+#include "cmath"
+#include "cstdlib"
+#include "limits"
+#include "string"
+#include "system_error"
+
+static auto alloc_count = 0u;
+namespace boost {
+namespace alignment {
+void *custom_aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+  ++alloc_count;
+  return aligned_alloc(alignment, size);
+}
+} // namespace alignment
+} // namespace boost
+#define aligned_alloc(alignment, size) custom_aligned_alloc(alignment, size)
+#include "stateful_pointer/charconv.hpp"
+
+using namespace stateful_pointer;
+
+template <typename T> void check_roundtrip(T v) {
+  const auto s = to_string(v);
+  T r = 0;
+  const auto res = from_chars(s, r);
+  BOOST_TEST(res.ec == std::errc());
+  BOOST_TEST(res.ptr == s.end());
+  BOOST_TEST_EQ(r, v);
+}
+
+int main() {
+  alloc_count = 0;
+  { // integers
+    BOOST_TEST(to_string(0) == "0");
+    BOOST_TEST(to_string(7) == "7");
+    BOOST_TEST(to_string(42) == "42");
+    BOOST_TEST(to_string(-42) == "-42");
+    BOOST_TEST(to_string(1234567) == "1234567");
+    BOOST_TEST(to_string(-123456) == "-123456");
+    BOOST_TEST_EQ(alloc_count, 0); // all fit into the pointer
+    BOOST_TEST(to_string(12345678) == "12345678");
+    BOOST_TEST_EQ(alloc_count, 1);
+    BOOST_TEST(to_string(std::numeric_limits<long long>::min()) ==
+               std::to_string(std::numeric_limits<long long>::min()));
+    BOOST_TEST(to_string(std::numeric_limits<unsigned long long>::max()) ==
+               std::to_string(std::numeric_limits<unsigned long long>::max()));
+    for (long long v = 1; v < 1000000000000000000LL; v *= 7) {
+      BOOST_TEST(to_string(v) == std::to_string(v));
+      BOOST_TEST(to_string(-v) == std::to_string(-v));
+    }
+  }
+
+  { // floating point
+    BOOST_TEST(to_string(0.0) == "0");
+    BOOST_TEST(to_string(0.5) == "0.5");
+    BOOST_TEST(to_string(-1.25) == "-1.25");
+    BOOST_TEST(to_string(0.1) == "0.1");
+    BOOST_TEST(to_string(1e100) == "1e+100");
+    BOOST_TEST(to_string(0.1f) == "0.1");
+    check_roundtrip(0.1 + 0.2);
+    check_roundtrip(1.0 / 3);
+    check_roundtrip(std::numeric_limits<double>::max());
+    check_roundtrip(std::numeric_limits<double>::denorm_min());
+    check_roundtrip(1.0f / 3);
+  }
+
+  { // parsing integers
+    int i = 0;
+    const string s1("123abc");
+    auto r = from_chars(s1, i);
+    BOOST_TEST(r.ec == std::errc());
+    BOOST_TEST_EQ(i, 123);
+    BOOST_TEST_EQ(r.ptr - s1.begin(), 3);
+
+    r = from_chars(string("-2147483648"), i);
+    BOOST_TEST(r.ec == std::errc());
+    BOOST_TEST_EQ(i, std::numeric_limits<int>::min());
+
+    i = 5;
+    r = from_chars(string("2147483648"), i);
+    BOOST_TEST(r.ec == std::errc::result_out_of_range);
+    BOOST_TEST_EQ(i, 5); // unchanged on error
+
+    const string s2("x1");
+    r = from_chars(s2, i);
+    BOOST_TEST(r.ec == std::errc::invalid_argument);
+    BOOST_TEST(r.ptr == s2.begin());
+    BOOST_TEST(from_chars(string("-"), i).ec == std::errc::invalid_argument);
+    BOOST_TEST(from_chars(string("+1"), i).ec == std::errc::invalid_argument);
+
+    unsigned u = 0;
+    BOOST_TEST(from_chars(string("-1"), u).ec == std::errc::invalid_argument);
+    BOOST_TEST(from_chars(string("4294967295"), u).ec == std::errc());
+    BOOST_TEST_EQ(u, 4294967295u);
+
+    check_roundtrip(std::numeric_limits<long long>::min());
+    check_roundtrip(std::numeric_limits<unsigned long long>::max());
+  }
+
+  { // parsing floating point
+    double d = 0;
+    const string s1("1.5e3x");
+    auto r = from_chars(s1, d);
+    BOOST_TEST(r.ec == std::errc());
+    BOOST_TEST_EQ(d, 1500.0);
+    BOOST_TEST_EQ(r.ptr - s1.begin(), 5);
+
+    d = 2;
+    BOOST_TEST(from_chars(string(" 1"), d).ec == std::errc::invalid_argument);
+    BOOST_TEST(from_chars(string("+1"), d).ec == std::errc::invalid_argument);
+    BOOST_TEST(from_chars(string("e5"), d).ec == std::errc::invalid_argument);
+    BOOST_TEST(from_chars(string("1e999"), d).ec ==
+               std::errc::result_out_of_range);
+    BOOST_TEST(from_chars(string("1e-999"), d).ec ==
+               std::errc::result_out_of_range);
+    BOOST_TEST_EQ(d, 2.0);
+
+    const std::string longer = "0." + std::string(100, '0') + "1";
+    const string s2(longer.data(), longer.size());
+    BOOST_TEST(from_chars(s2, d).ec == std::errc());
+    BOOST_TEST_EQ(d, 1e-101);
+
+    const wstring w(L"-0.25");
+    float f = 0;
+    BOOST_TEST(from_chars(w, f).ec == std::errc());
+    BOOST_TEST_EQ(f, -0.25f);
+
+    // hex is not read, only the leading zero like std::from_chars
+    const string s3("0x10");
+    r = from_chars(s3, d);
+    BOOST_TEST(r.ec == std::errc());
+    BOOST_TEST_EQ(d, 0.0);
+    BOOST_TEST_EQ(r.ptr - s3.begin(), 1);
+    const string s4("-0X1p4");
+    r = from_chars(s4, d);
+    BOOST_TEST(r.ec == std::errc());
+    BOOST_TEST_EQ(d, 0.0);
+    BOOST_TEST(std::signbit(d));
+    BOOST_TEST_EQ(r.ptr - s4.begin(), 2);
+
+    const string s5("-infinity");
+    r = from_chars(s5, d);
+    BOOST_TEST(r.ec == std::errc());
+    BOOST_TEST_EQ(d, -std::numeric_limits<double>::infinity());
+    BOOST_TEST_EQ(r.ptr - s5.begin(), 9);
+    BOOST_TEST(from_chars(string("inf"), d).ec == std::errc());
+    BOOST_TEST_EQ(d, std::numeric_limits<double>::infinity());
+    BOOST_TEST(from_chars(string("nan"), d).ec == std::errc());
+    BOOST_TEST(std::isnan(d));
+  }
+
+  { // the decimal point is always '.'
+    const char *names[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8",
+                           "German_Germany"};
+    bool comma = false;
+    for (const auto name : names)
+      if (std::setlocale(LC_ALL, name) &&
+          *std::localeconv()->decimal_point == ',') {
+        comma = true;
+        break;
+      }
+    if (!comma)
+      std::setlocale(LC_ALL, "C");
+
+    BOOST_TEST(to_string(0.5) == "0.5");
+    BOOST_TEST(to_string(-1.25f) == "-1.25");
+    double d = 0;
+    const string s1("2.5,1");
+    auto r = from_chars(s1, d);
+    BOOST_TEST(r.ec == std::errc());
+    BOOST_TEST_EQ(d, 2.5);
+    BOOST_TEST_EQ(r.ptr - s1.begin(), 3);
+    r = from_chars(string("2,5"), d);
+    BOOST_TEST_EQ(d, 2.0);
+    std::setlocale(LC_ALL, "C");
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,205 @@
+#include "boost/core/lightweight_test.hpp"
+#include "boost/align/aligned_alloc.hpp"
+#include "mutex"
+#include "random"
+#include "set"
+#include "stateful_pointer/gc_arena.hpp"
+#include "stdexcept"
+#include "thread"
+#include "vector"
+
+using namespace stateful_pointer;
+
+static unsigned destructor_count = 0;
+
+struct node {
+  int a;
+  gc_ptr<node, 2> left, right;
+  node(int x) : a(x) {}
+  ~node() { ++destructor_count; }
+};
+
+namespace stateful_pointer {
+template <> struct gc_traits<node> {
+  template <typename F> static void for_each_child(node &n, F &&f) {
+    f(n.left);
+    f(n.right);
+  }
+};
+} // namespace stateful_pointer
+
+// records which threads visit nodes, and lets others run on a single core
+struct traced {
+  gc_ptr<traced> left, right;
+};
+
+static std::mutex visitors_mutex;
+static std::set<std::thread::id> visitors;
+
+namespace stateful_pointer {
+template <> struct gc_traits<traced> {
+  template <typename F> static void for_each_child(traced &n, F &&f) {
+    {
+      std::lock_guard<std::mutex> lock(visitors_mutex);
+      visitors.insert(std::this_thread::get_id());
+    }
+    std::this_thread::yield();
+    f(n.left);
+    f(n.right);
+  }
+};
+} // namespace stateful_pointer
+
+// traversal throws on the visit which counts visits_left down to zero
+struct brittle {
+  gc_ptr<brittle> next;
+};
+
+static int visits_left = -1;
+
+namespace stateful_pointer {
+template <> struct gc_traits<brittle> {
+  template <typename F> static void for_each_child(brittle &n, F &&f) {
+    if (--visits_left == 0)
+      throw std::runtime_error("traversal failed");
+    f(n.next);
+  }
+};
+} // namespace stateful_pointer
+
+struct throwing {
+  explicit throwing(bool fail) {
+    if (fail)
+      throw std::runtime_error("constructor failed");
+  }
+};
+
+static int live_blocks = 0;
+struct counting_allocator {
+  static void *allocate(std::size_t alignment, std::size_t size) {
+    ++live_blocks;
+    return ::boost::alignment::aligned_alloc(alignment, size);
+  }
+  static void deallocate(void *p) noexcept {
+    --live_blocks;
+    ::boost::alignment::aligned_free(p);
+  }
+};
+
+int main() {
+  using ptr_t = gc_ptr<node, 2>;
+
+  // check that gc_ptr has the same size as void*
+  BOOST_TEST_EQ(sizeof(ptr_t), sizeof(void *));
+
+  destructor_count = 0;
+  { // cycles and tag bits
+    gc_arena<node, 2> arena;
+    auto a = arena.make(1);
+    auto b = arena.make(2);
+    auto c = arena.make(3);
+    arena.make(4); // unreachable
+    a->left = b;
+    b->left = a; // cycle
+    b->right = c;
+    c->right = c; // self-cycle
+    c->right.bits(3);
+    BOOST_TEST_EQ(c->right.bits(), 3u);
+    BOOST_TEST_EQ(c->right->a, 3);
+    BOOST_TEST_EQ(arena.size(), 4u);
+
+    std::vector<ptr_t> roots = {a};
+    BOOST_TEST_EQ(arena.collect(roots.begin(), roots.end()), 1u);
+    BOOST_TEST_EQ(arena.size(), 3u);
+    BOOST_TEST_EQ(destructor_count, 1u);
+    BOOST_TEST_EQ(a->left->right->a, 3);
+    BOOST_TEST_EQ(c->right.bits(), 3u); // user bits are untouched
+
+    // marks are cleared, so a second collection keeps the same objects
+    BOOST_TEST_EQ(arena.collect(roots.begin(), roots.end()), 0u);
+
+    b->right = ptr_t();
+    BOOST_TEST_EQ(arena.collect(roots.begin(), roots.end()), 1u);
+    BOOST_TEST_EQ(destructor_count, 2u);
+
+    roots.clear();
+    BOOST_TEST_EQ(arena.collect(roots.begin(), roots.end()), 2u);
+    BOOST_TEST_EQ(arena.size(), 0u);
+  }
+  BOOST_TEST_EQ(destructor_count, 4u);
+
+  destructor_count = 0;
+  { // arena frees everything left on destruction
+    gc_arena<node, 2> arena;
+    auto a = arena.make(1);
+    a->left = arena.make(2);
+  }
+  BOOST_TEST_EQ(destructor_count, 2u);
+
+  { // parallel marking agrees with serial marking
+    const int n = 20000;
+    gc_arena<node, 2> arena;
+    std::vector<ptr_t> nodes;
+    for (int i = 0; i < n; ++i)
+      nodes.push_back(arena.make(i));
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> dis(0, n - 1);
+    for (auto &p : nodes) {
+      p->left = nodes[dis(gen)];
+      if (dis(gen) % 4)
+        p->right = nodes[dis(gen)];
+    }
+    std::vector<ptr_t> roots(nodes.begin(), nodes.begin() + 10);
+    nodes.clear();
+
+    const auto serial = arena.collect(roots.begin(), roots.end(), 1);
+    BOOST_TEST(serial > 0u);
+    const auto alive = arena.size();
+    BOOST_TEST_EQ(arena.collect(roots.begin(), roots.end(), 4), 0u);
+    BOOST_TEST_EQ(arena.size(), alive);
+    roots.resize(1);
+    const auto freed = arena.collect(roots.begin(), roots.end(), 4);
+    BOOST_TEST_EQ(freed + arena.size(), alive);
+  }
+
+  { // a tree with a single root is marked by several threads
+    const std::size_t n = 1 << 12;
+    gc_arena<traced> arena;
+    std::vector<gc_ptr<traced>> nodes;
+    for (std::size_t i = 0; i < n; ++i)
+      nodes.push_back(arena.make());
+    for (std::size_t i = 0; 2 * i + 1 < n; ++i) {
+      nodes[i]->left = nodes[2 * i + 1];
+      if (2 * i + 2 < n)
+        nodes[i]->right = nodes[2 * i + 2];
+    }
+    nodes.resize(1);
+    BOOST_TEST_EQ(arena.collect(nodes.begin(), nodes.end(), 4), 0u);
+    BOOST_TEST(visitors.size() > 1u);
+  }
+
+  { // marking which throws frees nothing and leaves no marks behind
+    gc_arena<brittle> arena;
+    std::vector<gc_ptr<brittle>> roots(1, arena.make());
+    roots[0]->next = arena.make();
+    roots[0]->next->next = arena.make();
+    visits_left = 2;
+    BOOST_TEST_THROWS(arena.collect(roots.begin(), roots.end()),
+                      std::runtime_error);
+    BOOST_TEST_EQ(arena.size(), 3u);
+    visits_left = -1;
+    BOOST_TEST_EQ(arena.collect(roots.begin(), roots.end()), 0u);
+    BOOST_TEST_EQ(arena.size(), 3u);
+  }
+
+  { // constructor which throws does not leak
+    gc_arena<throwing, 0, counting_allocator> arena;
+    arena.make(false);
+    BOOST_TEST_THROWS(arena.make(true), std::runtime_error);
+    BOOST_TEST_EQ(arena.size(), 1u);
+    BOOST_TEST_EQ(live_blocks, 1);
+  }
+  BOOST_TEST_EQ(live_blocks, 0);
+
+  return boost::report_errors();
+}
@@ -0,0 +1,92 @@
+#include "boost/core/lightweight_test.hpp"
+#include "boost/cstdint.hpp"
+#include "stateful_pointer/hugepage_arena.hpp"
+#include "stateful_pointer/tagged_ptr.hpp"
+#include "thread"
+#include "vector"
+
+// destroyed after main returns, when its pointee must still be readable
+struct counted {
+  std::vector<int> values{1, 2, 3};
+};
+static stateful_pointer::tagged_ptr<counted, 4,
+                                    stateful_pointer::hugepage_allocator<>>
+    global_ptr;
+
+int main() {
+  using namespace stateful_pointer;
+
+  global_ptr = make_tagged<counted, 4, hugepage_allocator<>>();
+
+  { // counters and alignment
+    hugepage_arena a(1);
+    BOOST_TEST_EQ(a.mapped_bytes(), 0u);
+    BOOST_TEST_EQ(a.used_bytes(), 0u);
+
+    auto p1 = a.allocate(16, 3);
+    BOOST_TEST_EQ(reinterpret_cast<::boost::uintptr_t>(p1) % 16, 0u);
+    BOOST_TEST_EQ(a.mapped_bytes(), hugepage_arena::huge_page_size());
+    BOOST_TEST_EQ(a.used_bytes(), 3u);
+    BOOST_TEST(a.huge_page_bytes() <= a.mapped_bytes());
+
+    auto p2 = a.allocate(64, 5);
+    BOOST_TEST_EQ(reinterpret_cast<::boost::uintptr_t>(p2) % 64, 0u);
+    BOOST_TEST(p2 > p1);
+    BOOST_TEST_EQ(a.mapped_bytes(), hugepage_arena::huge_page_size());
+    BOOST_TEST_EQ(a.used_bytes(), 8u);
+
+    // request larger than a chunk maps a new, bigger chunk
+    auto p3 = static_cast<char *>(
+        a.allocate(8, hugepage_arena::huge_page_size() + 1));
+    p3[hugepage_arena::huge_page_size()] = 1; // memory is writable
+    BOOST_TEST_EQ(a.mapped_bytes(), 3 * hugepage_arena::huge_page_size());
+  }
+
+  static unsigned destructor_count_test_type = 0;
+  struct test_type {
+    int a;
+    test_type(int x) : a(x) {}
+    ~test_type() { ++destructor_count_test_type; }
+  };
+
+  struct tag;
+  using alloc_t = hugepage_allocator<tag>;
+
+  destructor_count_test_type = 0;
+  { // make_tagged with arena allocation policy
+    auto p = make_tagged<test_type, 4, alloc_t>(3);
+    BOOST_TEST_EQ(p->a, 3);
+    p.bits(15);
+    BOOST_TEST_EQ(p.bits(), 15u);
+    BOOST_TEST_EQ(p->a, 3);
+    BOOST_TEST_EQ(alloc_t::arena().used_bytes(), sizeof(test_type));
+
+    auto a = make_tagged<test_type[], 1, alloc_t>(10, 2);
+    BOOST_TEST_EQ(a.size(), 10u);
+    BOOST_TEST_EQ(a[9].a, 2);
+  }
+  BOOST_TEST_EQ(destructor_count_test_type, 11);
+
+  { // allocation policy is safe to use from several threads
+    struct mt_tag;
+    using mt_alloc_t = hugepage_allocator<mt_tag>;
+    const unsigned nthreads = 4, n = 10000;
+    std::vector<std::vector<tagged_ptr<int, 2, mt_alloc_t>>> v(nthreads);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < nthreads; ++t)
+      threads.emplace_back([&v, t] {
+        for (unsigned i = 0; i < n; ++i)
+          v[t].push_back(make_tagged<int, 2, mt_alloc_t>(t * n + i));
+      });
+    for (auto &t : threads)
+      t.join();
+    bool ok = true;
+    for (unsigned t = 0; t < nthreads; ++t)
+      for (unsigned i = 0; i < n; ++i)
+        ok &= *v[t][i] == static_cast<int>(t * n + i);
+    BOOST_TEST(ok);
+    BOOST_TEST_EQ(mt_alloc_t::arena().used_bytes(), nthreads * n * sizeof(int));
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,113 @@
+#define STATEFUL_POINTER_ENABLE_STATS
+#include "boost/core/lightweight_test.hpp"
+#include "stateful_pointer/string.hpp"
+#include "stateful_pointer/tagged_ptr.hpp"
+#include "thread"
+
+using namespace stateful_pointer;
+
+struct test_type {
+  char a[3];
+};
+
+template <typename T, unsigned Nbits> stats::allocation_counters find() {
+  for (const auto &r : stats::allocations())
+    if (r.nbits == Nbits &&
+        r.type == ::boost::core::demangled_name(BOOST_CORE_TYPEID(T)))
+      return r.counters;
+  return stats::allocation_counters();
+}
+
+int main() {
+  { // per type and Nbits
+    auto p = make_tagged<test_type, 4>();
+    auto q = make_tagged<test_type, 1>();
+    {
+      auto r = make_tagged<test_type, 4>();
+    }
+
+    auto c4 = find<test_type, 4>();
+    BOOST_TEST_EQ(c4.allocations, 2u);
+    BOOST_TEST_EQ(c4.deallocations, 1u);
+    BOOST_TEST_EQ(c4.requested_bytes, 2 * sizeof(test_type));
+    BOOST_TEST_EQ(c4.reserved_bytes, 2 * 16u);
+    BOOST_TEST_EQ(c4.live_bytes(), 16u);
+    BOOST_TEST_EQ(c4.padding_bytes(), 2 * (16 - sizeof(test_type)));
+
+    auto c1 = find<test_type, 1>();
+    BOOST_TEST_EQ(c1.allocations, 1u);
+    BOOST_TEST_EQ(c1.deallocations, 0u);
+    BOOST_TEST_EQ(c1.reserved_bytes, 4u);
+  }
+  BOOST_TEST_EQ((find<test_type, 4>().live_bytes()), 0u);
+  BOOST_TEST_EQ((find<test_type, 1>().live_bytes()), 0u);
+
+  { // arrays
+    auto a = make_tagged<char[], 3>(5);
+    auto b = make_tagged<char[10], 3>();
+    BOOST_TEST_EQ((find<char[], 3>().requested_bytes),
+                  sizeof(char *) + 5u);
+    BOOST_TEST_EQ((find<char[10], 3>().requested_bytes), 10u);
+  }
+  BOOST_TEST_EQ((find<char[], 3>().live_bytes()), 0u);
+  BOOST_TEST_EQ((find<char[10], 3>().live_bytes()), 0u);
+
+  { // counters of other threads are aggregated
+    std::thread t([] {
+      for (int i = 0; i < 10; ++i)
+        make_tagged<int, 2>();
+    });
+    t.join();
+    make_tagged<int, 2>();
+    BOOST_TEST_EQ((find<int, 2>().allocations), 11u);
+    BOOST_TEST_EQ((find<int, 2>().deallocations), 11u);
+  }
+
+  { // threads which end do not leave slots behind
+    const auto live = stats::detail::get_registry().live.size();
+    for (int i = 0; i < 20; ++i) {
+      std::thread t([] { make_tagged<char, 2>(); });
+      t.join();
+    }
+    BOOST_TEST_EQ(stats::detail::get_registry().live.size(), live);
+    BOOST_TEST_EQ((find<char, 2>().allocations), 20u);
+    BOOST_TEST_EQ((find<char, 2>().deallocations), 20u);
+  }
+
+  { // derived object freed through pointer to polymorphic base
+    struct base {
+      virtual ~base() = default;
+      int a;
+    };
+    struct derived : base {
+      int b[4];
+    };
+    {
+      tagged_ptr<base, 2> p = make_tagged<derived, 2>();
+      tagged_ptr<base, 2> q;
+      q = make_tagged<derived, 2>();
+      auto r = make_tagged<base, 2>();
+      // live objects are not recorded, only the size of derived
+      BOOST_TEST_EQ(stats::detail::get_registry().origins.size(), 1u);
+    }
+    const auto d = find<derived, 2>();
+    BOOST_TEST_EQ(d.allocations, 2u);
+    BOOST_TEST_EQ(d.deallocations, 2u);
+    BOOST_TEST_EQ(d.live_bytes(), 0u);
+    BOOST_TEST_EQ((find<base, 2>().deallocations), 1u);
+    BOOST_TEST_EQ((find<base, 2>().live_bytes()), 0u);
+  }
+
+  { // strings
+    string s1("abc");
+    string s2("abcdefghijklmnopqrstuvwxyz");
+    string s3(3, 'a');
+    auto recs = stats::strings();
+    BOOST_TEST_EQ(recs.size(), 1u);
+    BOOST_TEST_EQ(recs[0].counters.sso_strings, 2u);
+    BOOST_TEST_EQ(recs[0].counters.heap_strings, 1u);
+    BOOST_TEST_EQ(recs[0].counters.sso_ratio(), 2.0 / 3);
+  }
+
+  return boost::report_errors();
+}
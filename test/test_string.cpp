@@ -3,6 +3,7 @@
 #include "boost/core/lightweight_test.hpp"
 #include "sstream"
 #include "stdexcept"
+#include "string"
 
 static auto alloc_count = 0u;
 namespace boost {
@@ -69,6 +70,116 @@ int main() {
     BOOST_TEST_EQ(alloc_count, (sizeof(void *) == 8 ? 2 : 3));
   }
 
+  { // move
+    string s1("abc");
+    string s2(std::move(s1));
+    BOOST_TEST(s2 == "abc");
+    BOOST_TEST(s1.empty());
+
+    string s3("abcdefghijklmnopqrstuvwxyz");
+    string s4(std::move(s3));
+    BOOST_TEST(s4 == "abcdefghijklmnopqrstuvwxyz");
+    BOOST_TEST(s3.empty());
+
+    s2 = std::move(s4);
+    BOOST_TEST(s2 == "abcdefghijklmnopqrstuvwxyz");
+    s2 = string("xy");
+    BOOST_TEST(s2 == "xy");
+  }
+
+  { // ordering
+    BOOST_TEST(string("abc") < string("abd"));
+    BOOST_TEST(string("ab") < string("abc"));
+    BOOST_TEST(!(string("abc") < string("abc")));
+    BOOST_TEST(string("abcdefghijklmnopqrstuvwxyz") < string("b"));
+  }
+
+  { // packed encoding uses all character lanes
+    BOOST_TEST_EQ(sizeof(u16string), sizeof(void *));
+    BOOST_TEST_EQ(sizeof(u32string), sizeof(void *));
+#ifdef STATEFUL_POINTER_HAS_PACKED_SSO
+    const bool packed = true;
+#else
+    const bool packed = false;
+#endif
+
+    alloc_count = 0;
+    u32string s1(U"ab");
+    BOOST_TEST_EQ(s1.size(), 2);
+    BOOST_TEST(s1 == U"ab");
+    BOOST_TEST_EQ(s1[1], U'b');
+    BOOST_TEST_EQ(std::distance(s1.begin(), s1.end()), 2);
+    u32string s2(U"");
+    BOOST_TEST(s2.empty());
+    u32string s3(1, U'\U0010FFFF');
+    BOOST_TEST_EQ(s3.size(), 1);
+    BOOST_TEST_EQ(alloc_count, packed ? 0 : 1);
+
+    u16string s4(u"abcd");
+    BOOST_TEST_EQ(s4.size(), 4);
+    BOOST_TEST(s4 == u"abcd");
+    BOOST_TEST_EQ(s4[3], u'd');
+    u16string s5(3, u'x');
+    BOOST_TEST(s5 == u"xxx");
+    BOOST_TEST_EQ(alloc_count, packed ? 0 : 2);
+
+    // the highest bit of the last lane is reserved
+    u16string s6(u"abc\xFFFF");
+    BOOST_TEST_EQ(s6.size(), 4);
+    BOOST_TEST_EQ(s6[3], u'\xFFFF');
+    u16string s7(u"\xFFFF""abc");
+    BOOST_TEST_EQ(s7.size(), 4);
+    BOOST_TEST_EQ(alloc_count, packed ? 1 : 4);
+
+    // null characters do not fit inline
+    const char32_t z[] = {U'a', 0};
+    u32string s8(z, 2);
+    BOOST_TEST_EQ(s8.size(), 2);
+    BOOST_TEST_EQ(s8[1], 0);
+
+    u32string s9(U"abcdefgh");
+    BOOST_TEST(s9 == U"abcdefgh");
+    BOOST_TEST_EQ(alloc_count, packed ? 3 : 6);
+
+    u32string s10(std::move(s9));
+    BOOST_TEST(s10 == U"abcdefgh");
+    BOOST_TEST(s9.empty());
+    s10 = std::move(s1);
+    BOOST_TEST(s10 == U"ab");
+    BOOST_TEST(u16string(u"abc") < u16string(u"abd"));
+
+    basic_string<char, sso_packed> s11("abcdefg");
+    BOOST_TEST_EQ(s11.size(), 7);
+    BOOST_TEST_EQ(alloc_count, packed ? 3 : 6);
+  }
+
+  { // packed heap strings, the heap bit is never part of the pointer
+    alloc_count = 0;
+    std::u16string a(100, u'\xFFFF');
+    a[0] = u'a';
+    u16string s1(a.begin(), a.end());
+    BOOST_TEST_EQ(s1.size(), 100u);
+    BOOST_TEST(s1 == a);
+    BOOST_TEST_EQ(reinterpret_cast<boost::uintptr_t>(s1.begin()) >> 63, 0u);
+    s1[99] = u'z';
+    BOOST_TEST_EQ(s1[99], u'z');
+    BOOST_TEST_EQ(s1.end() - s1.begin(), 100);
+
+    const std::u32string b(50, U'\U0010FFFF');
+    u32string s2(b.begin(), b.end());
+    BOOST_TEST(s2 == b);
+    BOOST_TEST_EQ(reinterpret_cast<boost::uintptr_t>(s2.begin()) >> 63, 0u);
+    u32string s3(3, U'x');
+    BOOST_TEST(s3 == U"xxx");
+    BOOST_TEST_EQ(alloc_count, 3u);
+
+    u32string s4(std::move(s2));
+    BOOST_TEST(s4 == b);
+    BOOST_TEST(s2.empty());
+    s4 = u32string(U"ab");
+    BOOST_TEST(s4 == U"ab");
+  }
+
   { // ostream operator
     std::ostringstream os1;
     string s1("abc");
@@ -0,0 +1,143 @@
+#include "boost/core/lightweight_test.hpp"
+#include "cstdint"
+#include "cstdio"
+#include "fstream"
+#include "sstream"
+#include "stateful_pointer/string_table.hpp"
+#include "stdexcept"
+#include "string"
+#include "vector"
+
+using namespace stateful_pointer;
+
+static const char *path = "test_string_table.tmp";
+
+// number of mappings of the table file, or 0 if unknown
+std::size_t count_mappings() {
+  std::ifstream is("/proc/self/maps");
+  std::size_t n = 0;
+  std::string line;
+  while (std::getline(is, line))
+    n += line.find(path) != std::string::npos;
+  return n;
+}
+
+template <typename TChar>
+void write(const std::vector<basic_string<TChar>> &v) {
+  std::ofstream os(path, std::ios::binary);
+  write_string_table(os, v.begin(), v.end());
+}
+
+int main() {
+  // pointer-sized views
+  { BOOST_TEST_EQ(sizeof(mapped_string), sizeof(void *)); }
+
+  // short and long strings round-trip
+  {
+    std::vector<string> v;
+    v.emplace_back("");
+    v.emplace_back("a");
+    v.emplace_back("abcdef");
+    v.emplace_back("abcdefghijklmnopqrstuvwxyz");
+    v.emplace_back("1234567");
+    v.emplace_back("12345678");
+    v.emplace_back(1000, 'x');
+    write(v);
+
+    const string_table t(path);
+    BOOST_TEST_EQ(t.size(), v.size());
+    BOOST_TEST_EQ(t.end() - t.begin(), 7);
+    std::size_t i = 0;
+    for (const auto &s : t) {
+      BOOST_TEST_EQ(s.size(), v[i].size());
+      BOOST_TEST(s == v[i]);
+      ++i;
+    }
+    BOOST_TEST(t[0].empty());
+    BOOST_TEST(t[1] == "a");
+    BOOST_TEST(t[3] == "abcdefghijklmnopqrstuvwxyz");
+    BOOST_TEST_EQ(t[3][25], 'z');
+    BOOST_TEST(t[6] == std::string(1000, 'x'));
+
+    // long strings are null-terminated in the file
+    BOOST_TEST_EQ(*t[3].end(), '\0');
+
+    std::ostringstream os;
+    os << t[2] << t[5];
+    BOOST_TEST_EQ(os.str(), "abcdef12345678");
+  }
+
+  // empty table
+  {
+    std::vector<string> v;
+    write(v);
+    const string_table t(path);
+    BOOST_TEST(t.empty());
+    BOOST_TEST(t.begin() == t.end());
+  }
+
+  // wide strings
+  {
+    std::vector<wstring> v;
+    v.emplace_back(L"a");
+    v.emplace_back(L"abc");
+    write(v);
+    const wstring_table t(path);
+    BOOST_TEST_EQ(t.size(), 2u);
+    BOOST_TEST(t[0] == L"a");
+    BOOST_TEST(t[1] == L"abc");
+
+    // character size must match
+    BOOST_TEST_THROWS(string_table{path}, std::runtime_error);
+  }
+
+  // invalid files
+  {
+    BOOST_TEST_THROWS(string_table{"does_not_exist.tmp"}, std::runtime_error);
+
+    { std::ofstream os(path, std::ios::binary); }
+    BOOST_TEST_THROWS(string_table{path}, std::runtime_error);
+
+    {
+      std::ofstream os(path, std::ios::binary);
+      os << std::string(100, 'x');
+    }
+    BOOST_TEST_THROWS(string_table{path}, std::runtime_error);
+
+    // truncated blob
+    std::vector<string> v;
+    v.emplace_back(100, 'x');
+    write(v);
+    std::string data;
+    {
+      std::ifstream is(path, std::ios::binary);
+      data.assign(std::istreambuf_iterator<char>(is),
+                  std::istreambuf_iterator<char>());
+    }
+    {
+      std::ofstream os(path, std::ios::binary);
+      os.write(data.data(), data.size() - 8);
+    }
+    BOOST_TEST_THROWS(string_table{path}, std::runtime_error);
+    // a rejected file is unmapped again
+    BOOST_TEST_EQ(count_mappings(), 0u);
+
+    // sizes in the header which wrap around when added
+    write(std::vector<string>());
+    {
+      std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+      detail::string_table_header h;
+      fs.read(reinterpret_cast<char *>(&h), sizeof(h));
+      h.count = std::uint64_t(1) << 61;
+      h.blob_size = 16;
+      fs.seekp(0);
+      fs.write(reinterpret_cast<const char *>(&h), sizeof(h));
+      fs << std::string(16, 'x');
+    }
+    BOOST_TEST_THROWS(string_table{path}, std::runtime_error);
+  }
+
+  std::remove(path);
+
+  return boost::report_errors();
+}
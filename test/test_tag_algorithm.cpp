@@ -0,0 +1,113 @@
+#include "algorithm"
+#include "boost/core/lightweight_test.hpp"
+#include "stateful_pointer/tag_algorithm.hpp"
+#include "vector"
+
+using namespace stateful_pointer;
+
+using ptr_t = tagged_ptr<int, 4>;
+
+// run the same checks for every instruction set the CPU supports
+template <typename Kernel> void check_kernel(const std::vector<ptr_t> &v) {
+  using namespace detail::simd;
+  const auto p = detail::words(v.data());
+  const auto n = v.size();
+  const word ptr_mask = detail::make_ptr_mask(4);
+
+  BOOST_TEST_EQ(Kernel::count(p, n, 3, 1), scalar::count(p, n, 3, 1));
+  BOOST_TEST_EQ(Kernel::count(p, n, 15, 15), scalar::count(p, n, 15, 15));
+  BOOST_TEST_EQ(Kernel::find(p, n, 15, 13, true),
+                scalar::find(p, n, 15, 13, true));
+  BOOST_TEST_EQ(Kernel::find(p, n, 15, 0, false),
+                scalar::find(p, n, 15, 0, false));
+  BOOST_TEST_EQ(Kernel::find(p, n, 15, 7, false), 0u);
+  BOOST_TEST_EQ(Kernel::find(p + 1, n - 1, 0, 0, false), n - 1);
+
+  std::vector<word> a(n), b(n);
+  const auto na = Kernel::gather(p, n, 4, 4, ptr_mask, a.data());
+  const auto nb = scalar::gather(p, n, 4, 4, ptr_mask, b.data());
+  BOOST_TEST_EQ(na, nb);
+  BOOST_TEST(std::equal(a.begin(), a.begin() + na, b.begin()));
+
+  std::vector<word> c(p, p + n), d(p, p + n);
+  Kernel::set(c.data(), n, 8);
+  scalar::set(d.data(), n, 8);
+  BOOST_TEST(c == d);
+  Kernel::clear(c.data(), n, 9);
+  scalar::clear(d.data(), n, 9);
+  BOOST_TEST(c == d);
+}
+
+int main() {
+  std::vector<ptr_t> v;
+  for (int i = 0; i < 103; ++i) { // not a multiple of the vector width
+    v.push_back(make_tagged<int, 4>(i));
+    v.back().bits(i % 16);
+  }
+
+  { // public interface
+    const auto first = v.data();
+    const auto last = v.data() + v.size();
+
+    BOOST_TEST_EQ(count_bits(first, last, 15, 3), 7u);
+    BOOST_TEST_EQ(count_bits(first, last, 1, 1), 51u);
+    BOOST_TEST_EQ(count_bits(first, last, 0, 0), 103u);
+
+    BOOST_TEST_EQ(find_bits(first, last, 15, 5) - first, 5);
+    BOOST_TEST_EQ(find_bits(first + 6, last, 15, 5) - first, 21);
+    BOOST_TEST_EQ(find_bits(first, last, 15, 0, false) - first, 1);
+    BOOST_TEST(find_bits(first, last, 0, 0, false) == last);
+
+    std::vector<int *> out(v.size());
+    auto end = gather_bits(first, last, 15, 2, out.data());
+    BOOST_TEST_EQ(end - out.data(), 7);
+    BOOST_TEST_EQ(*out[0], 2);
+    BOOST_TEST_EQ(*out[1], 18);
+    BOOST_TEST_EQ(*out[6], 98);
+
+    set_bits(first, last, 8);
+    BOOST_TEST_EQ(count_bits(first, last, 8, 8), 103u);
+    BOOST_TEST_EQ(v[5].bits(), 13u);
+    BOOST_TEST_EQ(*v[5], 5);
+    clear_bits(first, last, 8);
+    BOOST_TEST_EQ(count_bits(first, last, 8, 0), 103u);
+    BOOST_TEST_EQ(v[5].bits(), 5u);
+    BOOST_TEST_EQ(*v[5], 5);
+    set_bits(first, last, ~0u); // pointer bits are not touched
+    BOOST_TEST_EQ(*v[5], 5);
+    BOOST_TEST_EQ(v[5].bits(), 15u);
+    clear_bits(first, last, ~0u);
+    BOOST_TEST_EQ(*v[5], 5);
+    BOOST_TEST_EQ(v[5].bits(), 0u);
+  }
+
+  for (int i = 0; i < 103; ++i)
+    v[i].bits(i % 16);
+
+  { // kernels
+    check_kernel<detail::simd::scalar>(v);
+    if (detail::simd::best() != detail::simd::isa::scalar)
+      check_kernel<detail::simd::avx2>(v);
+    if (detail::simd::best() == detail::simd::isa::avx512)
+      check_kernel<detail::simd::avx512>(v);
+  }
+
+  { // partition
+    const auto first = v.data();
+    const auto last = v.data() + v.size();
+    auto mid = partition_bits(first, last, 3, 1);
+    BOOST_TEST_EQ(mid - first, 26);
+    BOOST_TEST_EQ(count_bits(first, mid, 3, 1), 26u);
+    BOOST_TEST_EQ(count_bits(mid, last, 3, 1), 0u);
+    int sum = 0;
+    for (const auto &p : v)
+      sum += *p;
+    BOOST_TEST_EQ(sum, 102 * 103 / 2); // no element lost
+
+    BOOST_TEST(partition_bits(first, last, 0, 0) == last);
+    BOOST_TEST(partition_bits(first, last, 15, 99) == first);
+    BOOST_TEST(partition_bits(first, first, 0, 0) == first);
+  }
+
+  return boost::report_errors();
+}